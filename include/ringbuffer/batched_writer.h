@@ -0,0 +1,97 @@
+/*************************************************************************/
+/* ringbuffer - a multi-reader, lock-free ringbuffer lib                 */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef NO_CLASH_BATCHED_WRITER_H
+#define NO_CLASH_BATCHED_WRITER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "ringbuffer.h"
+
+//! front-end for writing single objects
+//! Each write of a ringbuffer_t publishes the write pointer, which makes
+//! the readers' cache line change on every object. This class stages the
+//! objects instead and writes them all at once, when @a batch objects are
+//! staged or on flush().
+template<class T>
+class batched_writer_t
+{
+	ringbuffer_t<T>* const rb;
+	std::vector<T> staged; //!< allocated once, in the ctor
+	std::size_t n_staged = 0;
+
+public:
+	//! @param arg_rb ringbuffer to write to. Do not write to it
+	//!   directly while objects are staged.
+	//! @param batch number of objects to collect before writing
+	batched_writer_t(ringbuffer_t<T>& arg_rb, std::size_t batch) :
+		rb(&arg_rb),
+		staged(batch)
+	{
+		assert(batch);
+	}
+
+	batched_writer_t(const batched_writer_t& ) = delete;
+
+	//! destructor. writes the staged objects
+	//! @note the ringbuffer must have space for them, otherwise they are
+	//!   lost. Call flush() until it succeeds before to be sure.
+	~batched_writer_t()
+	{
+		flush();
+		assert(!n_staged);
+	}
+
+	//! stages @a t and writes the batch if it is full
+	//! @return false if @a t could not be staged, because the batch is
+	//!   full and the ringbuffer has no space for any staged object
+	bool push(const T& t)
+	{
+		if(n_staged == staged.size())
+		{
+			// a partial flush also frees slots for t
+			flush();
+			if(n_staged == staged.size())
+			 return false;
+		}
+		staged[n_staged++] = t;
+		if(n_staged == staged.size())
+		 flush();
+		return true;
+	}
+
+	//! writes all staged objects that fit into the ringbuffer
+	//! @return true iff no objects are staged anymore
+	bool flush()
+	{
+		const std::size_t written = rb->write(staged.data(), n_staged);
+		if(written < n_staged)
+		 std::copy(staged.begin() + written,
+			staged.begin() + n_staged, staged.begin());
+		n_staged -= written;
+		return !n_staged;
+	}
+
+	//! number of objects that have not been written yet
+	std::size_t staged_count() const { return n_staged; }
+};
+
+#endif // NO_CLASH_BATCHED_WRITER_H
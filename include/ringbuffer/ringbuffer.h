@@ -23,11 +23,17 @@
 #include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <algorithm>
 #include <limits>
 
-// let CMake define RINGBUFFER_EXPORT
-#include "ringbuffer_export.h"
+#ifdef RINGBUFFER_HEADER_ONLY
+	// no library, nothing to export
+	#define RINGBUFFER_EXPORT
+#else
+	// let CMake define RINGBUFFER_EXPORT
+	#include "ringbuffer_export.h"
+#endif
 
 // Note: all units (size, space, pointers) are units of "T"
 //       e.g. if the current readable space is "4",
@@ -36,58 +42,176 @@
 template<class T>
 class ringbuffer_t;
 
+//! constructor tag: use the given size (rounded up to an even number)
+//! instead of rounding it up to a power of two
+struct exact_capacity_t {};
+constexpr exact_capacity_t exact_capacity = exact_capacity_t();
+
+#ifdef RINGBUFFER_MODEL_CHECK
+//! called after each atomic operation, to be defined by a model checker
+//! (see src/test/test_model.cpp)
+//! @param is_write whether the operation has modified the atomic
+void ringbuffer_schedule_point(bool is_write);
+#endif
+
+namespace detail
+{
+
+//! returns @a minimal if RINGBUFFER_MINIMAL_ORDERING is defined,
+//! otherwise @a conservative
+constexpr std::memory_order ordering(std::memory_order minimal,
+	std::memory_order conservative)
+{
+#ifdef RINGBUFFER_MINIMAL_ORDERING
+	return (void)conservative, minimal;
+#else
+	return (void)minimal, conservative;
+#endif
+}
+
+}
+
 //! common variables for both reader and writer
 class RINGBUFFER_EXPORT ringbuffer_common_t
 {
 private:
+	static std::size_t calc_exact_size(std::size_t sz);
+public:
+	//! size of a ringbuffer constructed with size @a sz (without
+	//! exact_capacity), i.e. the next power of two
 	static std::size_t calc_size(std::size_t sz);
 protected:
-	//!< max number of objects in buffer (2^n for some n)
+	//!< max number of objects in buffer (2^n for some n, unless the
+	//!< buffer was created with exact_capacity)
 	const std::size_t size;
-	const std::size_t size_mask; //!< = size - 1
+	//! = size - 1 if size is a power of two, otherwise 0 (see wrap())
+	const std::size_t size_mask;
+	const std::size_t half; //!< = size / 2
+
+	//! returns @a p modulo size, for @a p < 2 * size
+	std::size_t wrap(std::size_t p) const {
+		return size_mask ? (p & size_mask) : (p >= size ? p - size : p);
+	}
+	//! returns @a p - @a k modulo size, for @a p < size, @a k <= size
+	std::size_t wrap_back(std::size_t p, std::size_t k) const {
+		return wrap(p + size - k);
+	}
+	//! offset of @a p in its half
+	std::size_t offset_in_half(std::size_t p) const {
+		return p >= half ? p - half : p;
+	}
+	//! whether @a p1 and @a p2 are in different halves
+	bool other_half(std::size_t p1, std::size_t p2) const {
+		return (p1 >= half) != (p2 >= half);
+	}
 public:
 	ringbuffer_common_t(std::size_t sz);
+	ringbuffer_common_t(std::size_t sz, exact_capacity_t);
 };
 
 // note: the base classes contain the logic without any buffers
 //       especially, they are template-free and their code can easily
 //       be moved into cpp files
+//       the functions called on each read or write are still defined
+//       inline here, such that the compiler can inline them
 
 class RINGBUFFER_EXPORT ringbuffer_base : protected ringbuffer_common_t
 {
 	bool mlocked = false;
 
+	friend class ringbuffer_reader_base;
+
 	template<class T>
 	class rb_atomic
 	{
 		std::atomic<T> var;
+
+		static void schedule_point(bool is_write)
+		{
+#ifdef RINGBUFFER_MODEL_CHECK
+			ringbuffer_schedule_point(is_write);
+#else
+			(void)is_write;
+#endif
+		}
 	public:
 		T load(std::memory_order mo = std::memory_order_acquire) const
 		{
-			return var.load(mo);
+			const T res = var.load(mo);
+			schedule_point(false);
+			return res;
 		}
 		void store(const T& t, std::memory_order mo =
 			std::memory_order_release) {
 			var.store(t, mo);
+			schedule_point(true);
+		}
+		T exchange(const T& t, std::memory_order mo =
+			std::memory_order_acq_rel) {
+			const T res = var.exchange(t, mo);
+			schedule_point(true);
+			return res;
+		}
+		T fetch_add(T t, std::memory_order mo =
+			std::memory_order_acq_rel) {
+			const T res = var.fetch_add(t, mo);
+			schedule_point(true);
+			return res;
+		}
+		bool compare_exchange_weak(T& expected, const T& desired,
+			std::memory_order mo = std::memory_order_acq_rel,
+			std::memory_order mo_fail = std::memory_order_acquire) {
+			const bool res = var.compare_exchange_weak(expected,
+				desired, mo, mo_fail);
+			schedule_point(res);
+			return res;
 		}
 		rb_atomic() {}
 		//! this shall only be used for construction
 		rb_atomic(rb_atomic&& other) { store(other.load()); }
-
-		rb_atomic<T>& operator--() {
-			var.fetch_sub(1,
-				std::memory_order_acq_rel); // TODO: ??
-			return *this;
-		}
 	};
 
+	// Readers change their half (see DOCUMENTATION.md) independent of the
+	// writer. The writer counts its flips into the next half ("epochs").
+	// A reader knows the epoch of its half by counting its own flips.
+
+	// readers_left: | epoch (32 bit) | evicted (1 bit) | counter (31 bit) |
+	static constexpr std::uint64_t rl_counter_mask = (1u << 31) - 1;
+	static constexpr std::uint64_t rl_evicted = 1u << 31;
+	// membership: | epoch (32 bit) | joins (16 bit) | leaves (16 bit) |
+	static constexpr std::uint64_t join_one = 1u << 16;
+	static constexpr std::uint64_t leave_one = 1;
+
+	static std::uint32_t epoch_of(std::uint64_t v) {
+		return static_cast<std::uint32_t>(v >> 32);
+	}
+	static std::size_t readers_of(std::uint64_t rl) {
+		return static_cast<std::size_t>(rl & rl_counter_mask);
+	}
+
 protected:
 	rb_atomic<std::size_t> w_ptr; //!< writer at buf[w_ptr]
 	//! counts number of readers left in previous buffer half
-	rb_atomic<std::size_t> readers_left;
-	std::size_t num_readers = 0; //!< to be const after initialisation
-
-	using ringbuffer_common_t::ringbuffer_common_t;
+	//! (only the counter bits, the rest is for the epoch and eviction)
+	rb_atomic<std::uint64_t> readers_left;
+	//! readers that attached or detached in the current epoch,
+	//! the writer moves them into num_readers on the next flip
+	rb_atomic<std::uint64_t> membership;
+	//! only modified by the writer once it has started
+	std::size_t num_readers = 0;
+	//! number of objects behind the readers that the writer keeps intact
+	const std::size_t retain;
+	//! whether the writer has passed the buffer end at least once
+	rb_atomic<bool> wrapped;
+	//! whether readers can be evicted (set before registering readers)
+	bool evictable = false;
+	//! lag (in objects) that makes the writer evict readers, 0 = never
+	std::size_t evict_threshold = 0;
+
+	ringbuffer_base(std::size_t sz, std::size_t retain_sz = 0);
+	ringbuffer_base(std::size_t sz, exact_capacity_t,
+		std::size_t retain_sz = 0);
+	ringbuffer_base(const ringbuffer_common_t& common, std::size_t retain_sz);
 
 	bool munlock(const void* const buf, std::size_t each);
 	bool mlock(const void* const buf, std::size_t each);
@@ -95,15 +219,87 @@ protected:
 
 	void init_variables_for_write(std::size_t cnt,
 		std::size_t& w, std::size_t& to_write,
-		std::size_t& n1, std::size_t& n2);
+		std::size_t& n1, std::size_t& n2)
+	{
+		// relaxed is enough, only this thread stores w_ptr
+		w = w_ptr.load(detail::ordering(std::memory_order_relaxed,
+			std::memory_order_acquire));
+		// acquire: readers must have finished reading before we overwrite
+		const std::size_t rl = readers_of(readers_left.load());
+
+		// size calculations
+		const std::size_t free_cnt = write_space_preloaded(w, rl);
+		to_write = cnt > free_cnt ? free_cnt : cnt;
+
+		// entering the next half or evicting readers is rare,
+		// so keep it out of this (inlined) function
+		if(offset_in_half(w) + to_write >= half ||
+			(to_write < cnt && evict_threshold))
+		 to_write = write_slow(w, cnt, rl, to_write);
+
+		const std::size_t cnt2 = w + to_write;
+		if (cnt2 > size) {
+			n1 = size - w;
+			n2 = cnt2 - size;
+		} else {
+			n1 = to_write;
+			n2 = 0;
+		}
+	}
+
+	//! slow path of init_variables_for_write(): evicts lagging readers
+	//! if they block the writer and enters the next half if the write
+	//! reaches it
+	//! @param rl readers in the previous half, as loaded by the caller
+	//! @return number of objects to write, updated after evicting
+	std::size_t write_slow(std::size_t w, std::size_t cnt, std::size_t rl,
+		std::size_t to_write);
+
+	//! enters the next epoch, called when the writer changes its half
+	void flip();
 
 public:
 	//! returns number of objects that can be written at least
-	std::size_t write_space() const;
+	std::size_t write_space() const
+	{
+		// see init_variables_for_write
+		return write_space_preloaded(w_ptr.load(
+			detail::ordering(std::memory_order_relaxed,
+				std::memory_order_acquire)),
+			readers_of(readers_left.load()));
+	}
+
+	//! allow evicting readers, see evict_lagging()
+	//! @param threshold if non-zero, the writer evicts readers that block
+	//!   it automatically if they lag more than @a threshold objects behind
+	//!   (must be less than half of the buffer size)
+	//! @note call this before registering any readers
+	void enable_eviction(std::size_t threshold = 0)
+	{
+		if(threshold >= half)
+		 throw "eviction threshold does not fit into half the buffer";
+		evictable = true;
+		evict_threshold = threshold;
+	}
+
+	//! evicts all readers that still read the previous half, such that
+	//! the writer can continue. Evicted readers throw on their next read.
+	//! @note this may only be called from the writer thread, and only
+	//!   after enable_eviction()
+	//! @return number of evicted readers
+	std::size_t evict_lagging();
 private:
 	//! version for preloaded write ptr
 	std::size_t write_space_preloaded(std::size_t w,
-		std::size_t rl) const;
+		std::size_t rl) const
+	{
+		const std::size_t space =
+			(half - 1 - offset_in_half(w)) // = before next half
+			+ ((rl == false) * half) // one more block?
+				;
+		// keep the retained objects out of reach
+		return space > retain ? space - retain : 0;
+	}
 };
 
 //! TODO: specialization for only one reader
@@ -119,6 +315,10 @@ private:
 	template<class _T>
 	friend class ringbuffer_reader_t;
 
+protected:
+	//! for subclasses that keep data indexed like the buffer
+	const T* data() const { return buf; }
+
 public:
 	// TODO: auto mlock for all allocating functions?
 	// (bool auto_mlock param)
@@ -135,8 +335,11 @@ public:
 
 	//! allocating constructor
 	//! @param sz size of buffer being allocated
-	ringbuffer_t(std::size_t sz) :
-		ringbuffer_base(sz),
+	//! @param retain_sz number of objects behind each reader that are
+	//!   guaranteed not to be overwritten, see ringbuffer_reader_t::rewind
+	//!   (must be less than half of the buffer size)
+	ringbuffer_t(std::size_t sz, std::size_t retain_sz = 0) :
+		ringbuffer_base(sz, retain_sz),
 		buf(new T[ringbuffer_common_t::size])
 	{
 		if(! buf)
@@ -145,14 +348,25 @@ public:
 		// throw "Error allocting ringbuffer.";
 		init_atomic_variables();
 	}
+
+	//! allocating constructor, allocating exactly @a sz objects (rounded
+	//! up to an even number), see exact_capacity_t
+	//! @param retain_sz see above
+	ringbuffer_t(std::size_t sz, exact_capacity_t,
+		std::size_t retain_sz = 0) :
+		ringbuffer_base(sz, exact_capacity, retain_sz),
+		buf(new T[ringbuffer_common_t::size])
+	{
+		init_atomic_variables();
+	}
 	~ringbuffer_t() { munlock(); delete[] buf; }
 
 	// TODO: make constexpr if size is
 	//! size that is guaranteed to be writable once all readers
 	//! are up to date
 	std::size_t maximum_eventual_write_space() const {
-		// TODO: might be (size >> 1 + 1), not sure
-		return size >> 1;
+		// TODO: might be (half + 1), not sure
+		return half - retain;
 	}
 
 	//! writes max(cnt, write_space) of src into the buffer
@@ -173,14 +387,14 @@ public:
 
 		//std::copy_n(src, n1, &(buf[w]));
 		f(0, n1, buf + w);
-		w = (w + n1) & size_mask;
+		w = wrap(w + n1);
 		// update so readers are already informed:
 		w_ptr.store(w);
 
 		if (n2) {
 			//std::copy_n(src + n1, n2, &(buf[w]));
 			f(n1, n2, buf + w);
-			w = (w + n2) & size_mask;
+			w = wrap(w + n2);
 			w_ptr.store(w);
 		}
 
@@ -230,21 +444,263 @@ constexpr T2 if_than_or_zero(const bool& i1, const T2& i2) {
 	return (-(static_cast<int>(i1))) & i2;
 }
 
+//! hint to load the cache line at @a ptr for reading
+inline void prefetch(const void* ptr)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(ptr, 0, 3);
+#else
+	(void)ptr;
+#endif
+}
+
+//! calls @a f on each of the @a n objects at @a ptr, while prefetching
+//! the cache lines a few lines ahead
+template<class T, class Func>
+void for_each_prefetched(const T* ptr, std::size_t n, Func& f)
+{
+	constexpr std::size_t cache_line = 64;
+	constexpr std::size_t per_line =
+		sizeof(T) < cache_line ? cache_line / sizeof(T) : 1;
+	constexpr std::size_t ahead = 4 * per_line;
+	for(std::size_t i = 0; i < n; i += per_line)
+	{
+		if(i + ahead < n)
+		 prefetch(ptr + i + ahead);
+		const std::size_t end = std::min(n, i + per_line);
+		for(std::size_t j = i; j < end; ++j)
+		 f(ptr[j]);
+	}
+}
+
 }
 
 class RINGBUFFER_EXPORT ringbuffer_reader_base : protected ringbuffer_common_t
 {
+public:
+	//! where a newly connected reader starts reading
+	enum class start_position
+	{
+		current, //!< only objects written from now on
+		oldest_retained //!< see ringbuffer_reader_t::seek_to_oldest
+	};
+
 protected:
+	//! life cycle of a reader
+	enum class reader_state : unsigned char
+	{
+		unconnected,
+		joining, //!< attached, but the writer has not counted it yet
+		active,
+		evicted
+	};
+
 	std::size_t read_ptr = 0; //!< reader at buf[read_ptr]
+	//! how far read_ptr has been moved back by rewind()
+	//! (read_ptr + rewound is where the reader has been furthest)
+	std::size_t rewound = 0;
+	//! number of valid, retained objects before read_ptr + rewound
+	std::size_t history = 0;
+	std::size_t retain = 0; //!< copy of the writer's value
+	reader_state state = reader_state::unconnected;
+	bool evictable = false; //!< copy of the writer's value
+	//! the writer's epoch when it entered the half at read_ptr + rewound
+	std::uint32_t epoch = 0;
 
 	ringbuffer_reader_base(std::size_t sz);
+	ringbuffer_reader_base(std::size_t sz, exact_capacity_t);
+	//! copies the size of @a rb, so it is not recomputed
+	ringbuffer_reader_base(const ringbuffer_base& rb);
 
 	//! returns number of objects that can be read at least
-	std::size_t read_space(std::size_t w) const;
+	std::size_t read_space(std::size_t w) const
+	{
+		const std::size_t r = read_ptr;
+		if (w > r) {
+			return w - r;
+		} else {
+			return wrap(w + size - r);
+		}
+	}
+
 	//! returns read space of first halve (the one starting at read ptr)
-	std::size_t read_space_1(std::size_t range) const;
+	std::size_t read_space_1(std::size_t range) const
+	{
+		return std::min(range, size - read_ptr);
+	}
+
 	//! returns read space of second halve
-	std::size_t read_space_2(std::size_t range) const;
+	std::size_t read_space_2(std::size_t range) const
+	{
+		return range - read_space_1(range);
+	}
+
+	//! registers this reader at the writer
+	//! @note this is @a not thread-safe
+	void register_at(ringbuffer_base& rb,
+		start_position pos = start_position::current)
+	{
+		const std::size_t w = rb.w_ptr.load();
+		retain = rb.retain;
+		evictable = rb.evictable;
+		epoch = ringbuffer_base::epoch_of(rb.membership.load());
+		state = reader_state::active;
+		read_ptr = w;
+		rewound = 0;
+		history = rb.wrapped.load(std::memory_order_relaxed)
+			? retain : std::min(retain, w);
+		if(pos == start_position::oldest_retained)
+		 seek_to_oldest();
+		++rb.num_readers;
+	}
+
+	//! registers this reader at the writer, thread-safe
+	//! the reader will start at the beginning of the writer's next half
+	void attach_at(ringbuffer_base& rb,
+		start_position pos = start_position::current)
+	{
+		if(state == reader_state::active ||
+			state == reader_state::joining)
+		 throw "reader is already connected";
+		const std::uint64_t m =
+			rb.membership.fetch_add(ringbuffer_base::join_one);
+		retain = rb.retain;
+		evictable = rb.evictable;
+		epoch = ringbuffer_base::epoch_of(m) + 1u;
+		state = reader_state::joining;
+		read_ptr = (epoch & 1u) * half;
+		rewound = 0;
+		// the writer has written at least one half before that
+		history = retain;
+		if(pos == start_position::oldest_retained)
+		 seek_to_oldest();
+	}
+
+	//! unregisters this reader from the writer, thread-safe
+	void detach_from(ringbuffer_base& rb)
+	{
+		while(state == reader_state::active ||
+			state == reader_state::joining)
+		{
+			std::uint64_t m = rb.membership.load();
+			const std::int32_t diff = static_cast<std::int32_t>(
+				ringbuffer_base::epoch_of(m) - epoch);
+			if(diff < 0) {
+				// joining, the writer does not know about us yet
+				if(rb.membership.compare_exchange_weak(m,
+					m - ringbuffer_base::join_one))
+				 break;
+			}
+			else if(diff == 0) {
+				// the writer will stop counting us on its next flip
+				if(rb.membership.compare_exchange_weak(m,
+					m + ringbuffer_base::leave_one))
+				 break;
+			}
+			else if(diff == 1) {
+				// we are still blocking the writer
+				leave_half(rb);
+			}
+			else
+			 state = reader_state::evicted;
+		}
+		state = reader_state::unconnected;
+	}
+
+	//! returns whether the writer has evicted this reader
+	bool is_evicted(const ringbuffer_base& rb) const
+	{
+		if(state == reader_state::evicted)
+		 return true;
+		if(!evictable || state == reader_state::unconnected)
+		 return false;
+		const std::uint64_t rl = rb.readers_left.load();
+		const std::int32_t diff = static_cast<std::int32_t>(
+			ringbuffer_base::epoch_of(rl) - epoch);
+		return diff > 1 ||
+			(diff == 1 && (rl & ringbuffer_base::rl_evicted));
+	}
+
+	//! returns the writer's write pointer
+	//! @throws if the reader is not connected or has been evicted
+	std::size_t load_w_ptr(const ringbuffer_base& rb) const
+	{
+		if(state == reader_state::active && !evictable)
+		 return rb.w_ptr.load();
+		else
+		 return load_w_ptr_slow(rb);
+	}
+
+	std::size_t load_w_ptr_slow(const ringbuffer_base& rb) const
+	{
+		if(state == reader_state::unconnected)
+		 throw "reader is not connected";
+		if(state == reader_state::joining)
+		{
+			// load w first: if the epoch is still ours afterwards, w can
+			// not be beyond our half yet (otherwise, read_space() could
+			// drop back to 0 when the writer flips in between)
+			const std::size_t w = rb.w_ptr.load();
+			const std::int32_t diff = static_cast<std::int32_t>(
+				ringbuffer_base::epoch_of(rb.membership.load()) - epoch);
+			if(diff < 0)
+			 return read_ptr; // writer not in our half yet
+			const std::size_t hw = wrap(read_ptr + rewound);
+			// the writer has flipped, but not stored w in our half yet
+			if(diff == 0 && other_half(w, hw))
+			 return read_ptr;
+		}
+		if(is_evicted(rb))
+		 throw "reader has been evicted";
+		return rb.w_ptr.load();
+	}
+
+	//! tells the writer that the reader has left its half
+	void leave_half(ringbuffer_base& rb);
+
+	//! increases the @a read_ptr after reading from the buffer
+	void try_inc(ringbuffer_base& rb, std::size_t range)
+	{
+		const std::size_t old_read_ptr = wrap(read_ptr + rewound);
+
+		read_ptr = wrap(read_ptr + range);
+		if(rewound >= range)
+		{
+			// only re-read objects, the writer is not affected
+			rewound -= range;
+			return;
+		}
+		if(retain)
+		 history = std::min(retain, history + range - rewound);
+		rewound = 0;
+		if(state == reader_state::joining)
+		 state = reader_state::active; // we have seen data in our half
+
+		if(other_half(read_ptr, old_read_ptr))
+		{
+			leave_half(rb);
+		}
+	}
+
+public:
+	//! moves the reader back by up to @a k objects that have already
+	//! been read, but not further than the retained objects
+	//! (see the @a retain_sz parameter of ringbuffer_t)
+	//! @return number of objects the reader has been moved back
+	std::size_t rewind(std::size_t k)
+	{
+		k = std::min(k, history - rewound);
+		read_ptr = wrap_back(read_ptr, k);
+		rewound += k;
+		return k;
+	}
+
+	//! moves the reader back to the oldest retained object
+	//! @return number of objects the reader has been moved back
+	std::size_t seek_to_oldest() { return rewind(history); }
+
+	//! number of objects before the read pointer that can be read again
+	std::size_t rewindable() const { return history - rewound; }
 };
 
 template<class T>
@@ -277,8 +733,7 @@ class ringbuffer_reader_t : public ringbuffer_reader_base
 
 		//! single member access
 		const T& operator[](std::size_t idx) const {
-			return *(buf + ((reader_ref->read_ptr + idx) &
-				reader_ref->size_mask));
+			return *(buf + reader_ref->wrap(reader_ref->read_ptr + idx));
 		}
 
 		std::size_t size() const { return range; }
@@ -329,15 +784,7 @@ class ringbuffer_reader_t : public ringbuffer_reader_base
 	//! increases the @a read_ptr after reading from the buffer
 	void try_inc(std::size_t range)
 	{
-		const std::size_t old_read_ptr = read_ptr;
-
-		read_ptr = (read_ptr + range) & size_mask;
-		// TODO: inefficient xor
-		// checks if highest bit flipped:
-		if((read_ptr ^ old_read_ptr) & (size >> 1))
-		{
-			--ref->readers_left;
-		}
+		ringbuffer_reader_base::try_inc(*ref, range);
 	}
 
 public:
@@ -366,10 +813,11 @@ public:
 
 	//! constuctor. registers this reader at the ringbuffer
 	//! @note careful: this function is @a not thread-safe
-	ringbuffer_reader_t(ringbuffer_t<T> &arg_ref) :
-		ringbuffer_reader_base(arg_ref.size), buf(arg_ref.buf), ref(&arg_ref)
+	ringbuffer_reader_t(ringbuffer_t<T> &arg_ref,
+		start_position pos = start_position::current) :
+		ringbuffer_reader_base(arg_ref), buf(arg_ref.buf), ref(&arg_ref)
 	{
-		++arg_ref.num_readers; // register at the writer
+		register_at(arg_ref, pos);
 	}
 
 	//! constuctor. no registration yet
@@ -379,18 +827,54 @@ public:
 		buf(nullptr),
 		ref(nullptr) {}
 
+	//! constuctor for ringbuffers with exact_capacity. no registration yet
+	//! thread safe
+	ringbuffer_reader_t(std::size_t sz, exact_capacity_t) :
+		ringbuffer_reader_base(sz, exact_capacity),
+		buf(nullptr),
+		ref(nullptr) {}
+
 	//! @note careful: this function is @a not thread-safe
-	void connect(ringbuffer_t<T>& _ref)
+	void connect(ringbuffer_t<T>& _ref,
+		start_position pos = start_position::current)
 	{
 		if(size != _ref.size)
 		 throw "connecting ringbuffers of incompatible sizes";
 		else {
 			buf = _ref.buf;
 			ref = &_ref;
-			++_ref.num_readers; // register at the writer
+			register_at(_ref, pos);
 		}
 	}
 
+	//! like connect(), but can be called while the writer is running
+	//! the reader starts at the beginning of the writer's next half,
+	//! until then, read_space() is 0
+	//! @note thread safe
+	void attach(ringbuffer_t<T>& _ref,
+		start_position pos = start_position::current)
+	{
+		if(size != _ref.size)
+		 throw "connecting ringbuffers of incompatible sizes";
+		else {
+			if(ref && is_evicted(*ref))
+			 detach_from(*ref);
+			buf = _ref.buf;
+			ref = &_ref;
+			attach_at(_ref, pos);
+		}
+	}
+
+	//! unregisters this reader, such that the writer does not wait for
+	//! it anymore. Can be called while the writer is running.
+	//! @note thread safe
+	void detach() { detach_from(*ref); }
+
+	//! returns whether the writer has evicted this reader
+	//! (see ringbuffer_t::enable_eviction). If this returns true after a
+	//! read, the read objects may have been overwritten.
+	bool evicted() const { return is_evicted(*ref); }
+
 	//! reads min(@a range, @a read_space()) objects
 	read_sequence_t read_max(std::size_t range =
 		std::numeric_limits<std::size_t>::max()) {
@@ -415,13 +899,38 @@ public:
 
 	//! returns number of objects that can be read at least
 	std::size_t read_space() const {
-		std::size_t w =
-			ref->w_ptr.load();
-		return ringbuffer_reader_base::read_space(w);
+		return ringbuffer_reader_base::read_space(load_w_ptr(*ref));
+	}
+
+	//! reads all objects that are readable now and calls @a f on each
+	//! the objects are read in sequences of at most @a max_batch objects,
+	//! so the writer can continue after each sequence
+	//! @return number of objects passed to @a f
+	template<class Func>
+	std::size_t for_each_available(Func f, std::size_t max_batch =
+		std::numeric_limits<std::size_t>::max())
+	{
+		assert(max_batch);
+		const std::size_t avail = read_space();
+		std::size_t res = 0;
+		while(res < avail)
+		{
+			auto seq = read_max(std::min(max_batch, avail - res));
+			detail::for_each_prefetched(seq.first_half_ptr(),
+				seq.first_half_size(), f);
+			detail::for_each_prefetched(seq.second_half_ptr(),
+				seq.second_half_size(), f);
+			res += seq.size();
+		}
+		return res;
 	}
 
 	//! return the size that the reader expects from the ringbuffer
 	std::size_t get_size() const { return size; }
 };
 
+#ifdef RINGBUFFER_HEADER_ONLY
+	#include "ringbuffer_impl.h"
+#endif
+
 #endif // NO_CLASH_RINGBUFFER_H
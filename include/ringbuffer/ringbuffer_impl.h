@@ -0,0 +1,272 @@
+/*************************************************************************/
+/* ringbuffer - a multi-reader, lock-free ringbuffer lib                 */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+// Definitions of the non-inline functions of ringbuffer.h
+// This file is compiled into the library by src/lib/ringbuffer.cpp.
+// With RINGBUFFER_HEADER_ONLY, ringbuffer.h includes it directly
+// (define USE_MLOCK yourself in that case if you want mlock support).
+
+#ifndef NO_CLASH_RINGBUFFER_IMPL_H
+#define NO_CLASH_RINGBUFFER_IMPL_H
+
+#include "ringbuffer.h"
+
+#ifdef RINGBUFFER_HEADER_ONLY
+	#define RINGBUFFER_INLINE inline
+#else
+	#define RINGBUFFER_INLINE
+#endif
+
+#ifdef USE_MLOCK
+	#include <sys/mman.h>
+#endif
+
+/*
+	ringbuffer_common_t
+*/
+RINGBUFFER_INLINE std::size_t ringbuffer_common_t::calc_size(std::size_t sz)
+{
+	std::size_t power_of_two;
+	for (power_of_two = 1;
+		(static_cast<std::size_t>(1) << power_of_two) < sz; power_of_two++) ;
+	return 1 << power_of_two;
+}
+
+RINGBUFFER_INLINE std::size_t ringbuffer_common_t::calc_exact_size(
+	std::size_t sz)
+{
+	// both halves must have the same size
+	return sz < 2 ? 2 : sz + (sz & 1);
+}
+
+RINGBUFFER_INLINE ringbuffer_common_t::ringbuffer_common_t(std::size_t sz) :
+	size(calc_size(sz)),
+	size_mask(size - 1),
+	half(size >> 1)
+{}
+
+RINGBUFFER_INLINE ringbuffer_common_t::ringbuffer_common_t(std::size_t sz,
+	exact_capacity_t) :
+	size(calc_exact_size(sz)),
+	size_mask((size & (size - 1)) ? 0 : size - 1),
+	half(size >> 1)
+{}
+
+/*
+	ringbuffer_t
+*/
+RINGBUFFER_INLINE ringbuffer_base::ringbuffer_base(std::size_t sz,
+	std::size_t retain_sz) :
+	ringbuffer_base(ringbuffer_common_t(sz), retain_sz)
+{
+}
+
+RINGBUFFER_INLINE ringbuffer_base::ringbuffer_base(std::size_t sz,
+	exact_capacity_t, std::size_t retain_sz) :
+	ringbuffer_base(ringbuffer_common_t(sz, exact_capacity), retain_sz)
+{
+}
+
+RINGBUFFER_INLINE ringbuffer_base::ringbuffer_base(
+	const ringbuffer_common_t& common, std::size_t retain_sz) :
+	ringbuffer_common_t(common),
+	retain(retain_sz)
+{
+	if(retain >= half)
+	 throw "retention window does not fit into half the buffer";
+}
+
+RINGBUFFER_INLINE bool ringbuffer_base::munlock(const void* const buf,
+	std::size_t each)
+{
+	// we return true iff the buffer is unlocked at return time
+#ifdef USE_MLOCK
+	if (!mlocked) {
+		return true;
+	}
+	else {
+		// mlocked is true now
+		if (buf && !::munlock(buf, size * each)) {
+			mlocked = false;
+		}
+		return !mlocked;
+	}
+#else
+	(void)buf;
+	(void)each;
+	return !mlocked;
+#endif
+}
+
+RINGBUFFER_INLINE bool ringbuffer_base::mlock(const void* const buf,
+	std::size_t each)
+{
+	// we return true iff the buffer is locked at return time
+#ifdef USE_MLOCK
+	if (mlocked) {
+		return true;
+	}
+	else {
+		// mlocked is false now
+		if (buf && !::mlock(buf, size * each)) {
+			mlocked = true;
+		}
+		return mlocked;
+	}
+#else
+	(void)buf;
+	(void)each;
+	return mlocked;
+#endif
+}
+
+RINGBUFFER_INLINE std::size_t ringbuffer_base::write_slow(std::size_t w,
+	std::size_t cnt, std::size_t rl, std::size_t to_write)
+{
+	// readers in the previous half are at least offset_in_half(w) + 1
+	// objects behind. Evict them only if that already exceeds the
+	// threshold, so readers within the threshold are never evicted.
+	// (The writer can write up to the end of its half before, so it
+	// never blocks forever, since the threshold is less than a half.)
+	if(evict_threshold && rl && to_write < cnt &&
+		offset_in_half(w) >= evict_threshold)
+	{
+		evict_lagging();
+		rl = readers_of(readers_left.load());
+		const std::size_t free_cnt = write_space_preloaded(w, rl);
+		to_write = cnt > free_cnt ? free_cnt : cnt;
+	}
+
+	// reset readers_left
+	const std::size_t cnt2 = w + to_write;
+	if(other_half(w, wrap(cnt2)))
+	{
+		if(rl)
+		 throw "impossible";
+		flip();
+		// the w_ptr store will publish this to the readers
+		if(cnt2 >= size)
+		 wrapped.store(true, std::memory_order_relaxed);
+	}
+	return to_write;
+}
+
+RINGBUFFER_INLINE void ringbuffer_base::flip()
+{
+	// only the writer changes the epoch
+	const std::uint64_t epoch = epoch_of(membership.load(
+		detail::ordering(std::memory_order_relaxed,
+			std::memory_order_acquire))) + 1u;
+	// acquire: detached readers must have finished reading
+	const std::uint64_t m = membership.exchange(epoch << 32,
+		detail::ordering(std::memory_order_acquire,
+			std::memory_order_acq_rel));
+	const std::size_t joins = (m >> 16) & 0xffff,
+		leaves = m & 0xffff;
+	num_readers = num_readers + joins - leaves;
+	// readers that just joined start in the new half
+	// (relaxed: the readers only rely on the w_ptr store that follows)
+	readers_left.store((epoch << 32) | (num_readers - joins),
+		detail::ordering(std::memory_order_relaxed,
+			std::memory_order_release));
+}
+
+RINGBUFFER_INLINE std::size_t ringbuffer_base::evict_lagging()
+{
+	assert(evictable);
+	std::uint64_t rl = readers_left.load();
+	while(readers_of(rl))
+	{
+		if(readers_left.compare_exchange_weak(rl,
+			(rl & ~rl_counter_mask) | rl_evicted))
+		{
+			num_readers -= readers_of(rl);
+			return readers_of(rl);
+		}
+	}
+	return 0;
+}
+
+RINGBUFFER_INLINE void ringbuffer_base::init_atomic_variables()
+{
+	// relaxed is enough, since the threads using the ringbuffer
+	// are started after the construction
+	const std::memory_order mo = detail::ordering(
+		std::memory_order_relaxed, std::memory_order_release);
+	w_ptr.store(0, mo);
+	readers_left.store(0, mo);
+	membership.store(0, mo);
+	wrapped.store(false, mo);
+}
+
+/*
+	ringbuffer_reader_t
+*/
+RINGBUFFER_INLINE ringbuffer_reader_base::ringbuffer_reader_base(
+	std::size_t sz) :
+	ringbuffer_common_t(sz)
+{
+}
+
+RINGBUFFER_INLINE ringbuffer_reader_base::ringbuffer_reader_base(
+	std::size_t sz, exact_capacity_t) :
+	ringbuffer_common_t(sz, exact_capacity)
+{
+}
+
+RINGBUFFER_INLINE ringbuffer_reader_base::ringbuffer_reader_base(
+	const ringbuffer_base& rb) :
+	ringbuffer_common_t(rb)
+{
+}
+
+RINGBUFFER_INLINE void ringbuffer_reader_base::leave_half(
+	ringbuffer_base& rb)
+{
+	const std::uint32_t next = epoch + 1u;
+	std::uint64_t rl = rb.readers_left.load(std::memory_order_relaxed);
+	for(;;)
+	{
+		const std::int32_t diff = static_cast<std::int32_t>(
+			ringbuffer_base::epoch_of(rl) - next);
+		if(diff < 0) {
+			// writer is just flipping (only happens on detach)
+			rl = rb.readers_left.load(std::memory_order_relaxed);
+		}
+		else if(diff > 0 || (rl & ringbuffer_base::rl_evicted)) {
+			state = reader_state::evicted;
+			return;
+		}
+		// release: we have finished reading this half
+		// the writer's acquire load syncs with all decrements
+		// (release sequence)
+		else if(rb.readers_left.compare_exchange_weak(rl, rl - 1,
+			detail::ordering(std::memory_order_release,
+				std::memory_order_acq_rel),
+			detail::ordering(std::memory_order_relaxed,
+				std::memory_order_acquire))) {
+			epoch = next;
+			return;
+		}
+	}
+}
+
+#undef RINGBUFFER_INLINE
+
+#endif // NO_CLASH_RINGBUFFER_IMPL_H
@@ -0,0 +1,372 @@
+/*************************************************************************/
+/* ringbuffer - a multi-reader, lock-free ringbuffer lib                 */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef NO_CLASH_SHARDED_RINGBUFFER_H
+#define NO_CLASH_SHARDED_RINGBUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ringbuffer.h"
+
+template<class T>
+class sharded_reader_t;
+
+//! facade for multiple producer threads
+//! each producer thread writes into its own (single writer) ringbuffer,
+//! called "shard". The shard is created on the first write of the thread.
+//! When the thread exits, the next new producer thread takes over its shard.
+//! Readers (see sharded_reader_t) read all shards as one stream.
+template<class T>
+class sharded_ringbuffer_t
+{
+public:
+	using value_type = T;
+private:
+	template<class _T>
+	friend class sharded_reader_t;
+
+	const std::size_t shard_size, max_shards;
+	//! see maximum_eventual_write_space()
+	const std::size_t eventual_write_space;
+	const std::size_t instance_id; //!< identifies this facade in caches
+	//! number of facades whose shard each thread can find without locking
+	static constexpr std::size_t cache_size = 8;
+
+	//! shards [0, num_shards) are readable for everyone
+	std::atomic<std::size_t> num_shards;
+	std::vector<std::unique_ptr<ringbuffer_t<T>>> shards;
+	std::vector<std::thread::id> owners; //!< owners[i] writes shards[i]
+	//! orphaned[i] is set when owners[i] has exited
+	//! (shared, since the thread might exit after the facade is destroyed)
+	std::vector<std::shared_ptr<std::atomic<bool>>> orphaned;
+
+	//! protects shard creation and the readers list
+	std::mutex registration_mutex;
+	std::vector<sharded_reader_t<T>*> readers;
+
+	static std::size_t next_instance_id()
+	{
+		static std::atomic<std::size_t> counter(0);
+		return ++counter;
+	}
+
+	//! the orphaned flags of the shards the calling thread owns
+	struct owned_shards_t
+	{
+		std::vector<std::shared_ptr<std::atomic<bool>>> flags;
+		~owned_shards_t()
+		{
+			// release: the next owner must see all our writes
+			for(const std::shared_ptr<std::atomic<bool>>& f : flags)
+			 f->store(true, std::memory_order_release);
+		}
+	};
+
+	static owned_shards_t& owned_shards()
+	{
+		static thread_local owned_shards_t owned;
+		return owned;
+	}
+
+	//! slow path of local_shard(): find, take over or create the shard of
+	//! this thread
+	ringbuffer_t<T>& register_shard()
+	{
+		std::lock_guard<std::mutex> lock(registration_mutex);
+		const std::thread::id me = std::this_thread::get_id();
+		const std::size_t n = num_shards.load(std::memory_order_relaxed);
+		std::size_t i = 0;
+		// an orphaned shard's owner id might have been reused by us
+		for(; i < n && (owners[i] != me ||
+			orphaned[i]->load(std::memory_order_relaxed)); ++i)
+		;
+		if(i < n)
+		 return *shards[i];
+
+		for(i = 0; i < n &&
+			!orphaned[i]->load(std::memory_order_acquire); ++i)
+		;
+		if(i < n)
+		 orphaned[i]->store(false, std::memory_order_relaxed);
+		else if(n == max_shards)
+		 throw "sharded ringbuffer: too many producer threads";
+		else
+		{
+			shards[n].reset(new ringbuffer_t<T>(shard_size));
+			orphaned[n].reset(new std::atomic<bool>(false));
+			// the new shard is not published yet, so connecting is safe
+			for(sharded_reader_t<T>* rd : readers)
+			 rd->slots[n].connect(*shards[n]);
+			num_shards.store(n + 1, std::memory_order_release);
+		}
+		owners[i] = me;
+
+		// forget the flags of destroyed facades
+		std::vector<std::shared_ptr<std::atomic<bool>>>& flags =
+			owned_shards().flags;
+		flags.erase(std::remove_if(flags.begin(), flags.end(),
+			[](const std::shared_ptr<std::atomic<bool>>& f) {
+				return f.use_count() == 1; }), flags.end());
+		flags.push_back(orphaned[i]);
+		return *shards[i];
+	}
+
+public:
+	//! allocating constructor. Shards are allocated on first use.
+	//! @param sz size of each shard
+	//! @param max_producers maximum number of threads that write at the
+	//!   same time (exited threads do not count)
+	sharded_ringbuffer_t(std::size_t sz, std::size_t max_producers) :
+		shard_size(sz),
+		max_shards(max_producers),
+		eventual_write_space(ringbuffer_common_t::calc_size(sz) >> 1),
+		instance_id(next_instance_id()),
+		num_shards(0),
+		shards(max_producers),
+		owners(max_producers),
+		orphaned(max_producers)
+	{
+	}
+
+	sharded_ringbuffer_t(const sharded_ringbuffer_t& ) = delete;
+
+	//! returns the shard of the calling thread, creating it if required
+	//! @note the first call of each thread is not realtime safe
+	ringbuffer_t<T>& local_shard()
+	{
+		// each thread caches the shards of the facades it used last
+		// (instance ids are never reused, so old entries can not match)
+		struct entry_t {
+			std::size_t instance = 0;
+			ringbuffer_t<T>* shard = nullptr;
+		};
+		struct cache_t {
+			entry_t entries[cache_size];
+			std::size_t next = 0; //!< entry to replace next
+		};
+		static thread_local cache_t cache;
+		for(entry_t& e : cache.entries)
+		 if(e.instance == instance_id)
+		  return *e.shard;
+
+		entry_t& e = cache.entries[cache.next];
+		cache.next = (cache.next + 1) % cache_size;
+		e.shard = &register_shard();
+		e.instance = instance_id;
+		return *e.shard;
+	}
+
+	//! writes into the shard of the calling thread
+	//! @return number of objects successfully written
+	std::size_t write(const T *src, std::size_t cnt) {
+		return local_shard().write(src, cnt);
+	}
+
+	template<class Func>
+	std::size_t write_func(Func& f, std::size_t cnt) {
+		return local_shard().template write_func<Func>(f, cnt);
+	}
+
+	//! returns number of objects the calling thread can write at least
+	std::size_t write_space() { return local_shard().write_space(); }
+
+	//! size that is guaranteed to be writable by each producer once all
+	//! readers are up to date
+	std::size_t maximum_eventual_write_space() const {
+		return eventual_write_space;
+	}
+
+	//! number of producers that have written so far
+	std::size_t get_num_shards() const {
+		return num_shards.load(std::memory_order_acquire);
+	}
+};
+
+//! reader for all shards of a sharded_ringbuffer_t
+//! The order between the shards is given by the read function used.
+//! The order of elements from the same shard is always kept.
+template<class T>
+class sharded_reader_t
+{
+	template<class _T>
+	friend class sharded_ringbuffer_t;
+
+	sharded_ringbuffer_t<T>* ref;
+	//! slots[i] reads ref->shards[i]
+	std::vector<ringbuffer_reader_t<T>> slots;
+	std::size_t next = 0; //!< shard to continue with for round robin
+
+	//! calls @a f on each object of the sequence and returns its size
+	template<class Seq, class Func>
+	static std::size_t consume(const Seq& seq, Func& f)
+	{
+		for(std::size_t i = 0; i < seq.size(); ++i)
+		 f(seq[i]);
+		return seq.size();
+	}
+
+public:
+	//! constructor. registers this reader at the facade
+	//! The reader starts reading each existing shard at the beginning of its
+	//! producer's next half (see ringbuffer_reader_t::attach), and new
+	//! shards from their beginning.
+	sharded_reader_t(sharded_ringbuffer_t<T>& arg_ref) : ref(&arg_ref)
+	{
+		std::lock_guard<std::mutex> lock(ref->registration_mutex);
+		slots.reserve(ref->max_shards); // slots must never move
+		for(std::size_t i = 0; i < ref->max_shards; ++i)
+		 slots.emplace_back(ref->shard_size);
+		// the producers might be writing into published shards
+		const std::size_t n = ref->num_shards.load(std::memory_order_relaxed);
+		for(std::size_t i = 0; i < n; ++i)
+		 slots[i].attach(*ref->shards[i]);
+		ref->readers.push_back(this);
+	}
+
+	sharded_reader_t(const sharded_reader_t& ) = delete;
+
+	//! destructor. unregisters this reader from the facade and all shards,
+	//! such that the producers do not wait for it anymore
+	~sharded_reader_t()
+	{
+		std::lock_guard<std::mutex> lock(ref->registration_mutex);
+		const std::size_t n = ref->num_shards.load(std::memory_order_relaxed);
+		for(std::size_t i = 0; i < n; ++i)
+		 slots[i].detach();
+		ref->readers.erase(std::find(ref->readers.begin(),
+			ref->readers.end(), this));
+	}
+
+	//! returns number of objects that can be read at least
+	std::size_t read_space() const
+	{
+		const std::size_t n = ref->get_num_shards();
+		std::size_t res = 0;
+		for(std::size_t i = 0; i < n; ++i)
+		 res += slots[i].read_space();
+		return res;
+	}
+
+	//! reads up to @a max objects, taking one object of each shard in turn
+	//! @return number of objects passed to @a f
+	template<class Func>
+	std::size_t read_round_robin(Func f, std::size_t max =
+		std::numeric_limits<std::size_t>::max())
+	{
+		return read_batched(f, 1, max);
+	}
+
+	//! reads up to @a max objects, taking up to @a batch objects of each
+	//! shard in turn
+	//! @return number of objects passed to @a f
+	template<class Func>
+	std::size_t read_batched(Func f, std::size_t batch,
+		std::size_t max = std::numeric_limits<std::size_t>::max())
+	{
+		const std::size_t n = ref->get_num_shards();
+		std::size_t res = 0;
+		// stop after a complete round without any data
+		std::size_t idle = 0;
+		while(idle < n && res < max)
+		{
+			if(next >= n)
+			 next = 0;
+			const std::size_t got = consume(slots[next++].read_max(
+				std::min(batch, max - res)), f);
+			if(got) {
+				res += got;
+				idle = 0;
+			}
+			else
+			 ++idle;
+		}
+		return res;
+	}
+
+	//! reads up to @a max objects, always taking the object with the
+	//! lowest key (e.g. a timestamp or a sequence number) of all shards
+	//! @note The result is only ordered if each producer writes with
+	//!   increasing keys. Objects that are written after the call has
+	//!   started are not taken into account. The objects are marked as
+	//!   read when the call returns.
+	//! @note the first calls of each thread are not realtime safe
+	//! @param key function object returning a comparable key for a T
+	//! @return number of objects passed to @a f
+	template<class Func, class Key>
+	std::size_t read_ordered(Func f, Key key, std::size_t max =
+		std::numeric_limits<std::size_t>::max())
+	{
+		using key_type = typename std::decay<
+			decltype(key(std::declval<const T&>()))>::type;
+		//! the objects of one shard that are readable when we start
+		struct head_t {
+			ringbuffer_reader_t<T>* slot;
+			typename ringbuffer_reader_t<T>::peak_sequence_t seq;
+			std::size_t pos; //!< number of objects passed to f
+			key_type key; //!< key of seq[pos], if pos < seq.size()
+		};
+		// reused, so only the first calls (of each thread) allocate
+		static thread_local std::vector<head_t> heads;
+		heads.clear();
+
+		// the shards are only accessed atomically here and when
+		// marking the objects as read
+		const std::size_t n = ref->get_num_shards();
+		for(std::size_t i = 0; i < n; ++i)
+		{
+			auto seq = slots[i].peak_max();
+			if(seq.size())
+			{
+				const key_type first = key(seq[0]);
+				heads.push_back(head_t{&slots[i], std::move(seq), 0, first});
+			}
+		}
+
+		std::size_t res = 0;
+		for(; res < max; ++res)
+		{
+			head_t* best = nullptr;
+			for(head_t& h : heads)
+			 if(h.pos < h.seq.size() && (!best || h.key < best->key))
+			  best = &h;
+			if(!best)
+			 break;
+			f(best->seq[best->pos]);
+			// only the key of the shard we took from changes
+			if(++best->pos < best->seq.size())
+			 best->key = key(best->seq[best->pos]);
+		}
+
+		for(head_t& h : heads)
+		 h.slot->read_max(h.pos);
+		heads.clear();
+		return res;
+	}
+};
+
+#endif // NO_CLASH_SHARDED_RINGBUFFER_H
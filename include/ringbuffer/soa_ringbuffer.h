@@ -0,0 +1,324 @@
+/*************************************************************************/
+/* ringbuffer - a multi-reader, lock-free ringbuffer lib                 */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef NO_CLASH_SOA_RINGBUFFER_H
+#define NO_CLASH_SOA_RINGBUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+#include "ringbuffer.h"
+
+// "SoA" = struct of arrays
+// Each frame consists of `Channels` objects of type T. The ringbuffer stores
+// each channel in an own contiguous array. All channels share the write
+// pointer and the reader states, i.e. all units are still frames.
+
+template<class T, std::size_t Channels>
+class soa_ringbuffer_t : public ringbuffer_base
+{
+	static_assert(Channels > 0, "soa ringbuffer needs at least 1 channel");
+public:
+	using value_type = T;
+	static constexpr std::size_t channels = Channels;
+private:
+
+	T* const buf; //!< channel c is at buf[c * size]
+
+	template<class _T, std::size_t _Channels>
+	friend class soa_ringbuffer_reader_t;
+
+public:
+	soa_ringbuffer_t(const soa_ringbuffer_t& ) = delete;
+
+	//! allocating constructor
+	//! @param sz size of buffer being allocated, in frames
+	soa_ringbuffer_t(std::size_t sz) :
+		ringbuffer_base(sz),
+		buf(new T[ringbuffer_common_t::size * Channels])
+	{
+		init_atomic_variables();
+	}
+
+	//! allocating constructor, see exact_capacity_t
+	soa_ringbuffer_t(std::size_t sz, exact_capacity_t) :
+		ringbuffer_base(sz, exact_capacity),
+		buf(new T[ringbuffer_common_t::size * Channels])
+	{
+		init_atomic_variables();
+	}
+	~soa_ringbuffer_t() { munlock(); delete[] buf; }
+
+	//! size that is guaranteed to be writable once all readers
+	//! are up to date
+	std::size_t maximum_eventual_write_space() const {
+		return half;
+	}
+
+	//! writes max(frames, write_space) frames using the copier @a f
+	//! @a f is called as f(src_off, amnt, dest), where dest[c] points
+	//! to the destination of channel c
+	//! @return number of frames successfully written
+	template<class Func>
+	std::size_t write_func(Func& f, std::size_t frames)
+	{
+		std::size_t w, to_write, n1, n2;
+		init_variables_for_write(frames, w, to_write, n1, n2);
+
+		T* dest[Channels];
+		for(std::size_t c = 0; c < Channels; ++c)
+		 dest[c] = buf + c * size + w;
+		f(0, n1, dest);
+		w = wrap(w + n1);
+		w_ptr.store(w);
+
+		if (n2) {
+			for(std::size_t c = 0; c < Channels; ++c)
+			 dest[c] = buf + c * size + w;
+			f(n1, n2, dest);
+			w = wrap(w + n2);
+			w_ptr.store(w);
+		}
+
+		return to_write;
+	}
+
+	//! copier for `write_func` that deinterleaves frames
+	//! (src[i * Channels + c] is channel c of frame i)
+	class deinterleave_copy
+	{
+		const T* const src;
+	public:
+		void operator()(std::size_t src_off, std::size_t amnt,
+			T* const* dest)
+		{
+			const T* s = src + src_off * Channels;
+			// Channels is a constant, so the compiler can unroll
+			// the inner loop and vectorize the outer one
+			for(std::size_t i = 0; i < amnt; ++i, s += Channels)
+			 for(std::size_t c = 0; c < Channels; ++c)
+			  dest[c][i] = s[c];
+		}
+		deinterleave_copy(const T* arg_src) : src(arg_src) {}
+	};
+
+	//! copier for `write_func` that copies each channel
+	//! (src[c][i] is channel c of frame i)
+	class planar_copy
+	{
+		const T* const* const src;
+	public:
+		void operator()(std::size_t src_off, std::size_t amnt,
+			T* const* dest)
+		{
+			for(std::size_t c = 0; c < Channels; ++c)
+			 std::copy_n(src[c] + src_off, amnt, dest[c]);
+		}
+		planar_copy(const T* const* arg_src) : src(arg_src) {}
+	};
+
+	//! writes interleaved frames, see `deinterleave_copy`
+	std::size_t write_interleaved(const T* src, std::size_t frames) {
+		deinterleave_copy func(src);
+		return write_func<deinterleave_copy>(func, frames);
+	}
+
+	//! writes one array per channel, see `planar_copy`
+	std::size_t write_planar(const T* const* src, std::size_t frames) {
+		planar_copy func(src);
+		return write_func<planar_copy>(func, frames);
+	}
+
+	//! try to lock the data block using the syscall @a mlock
+	//! @return true iff the pages are guaranteed to be locked in RAM now
+	bool mlock() {
+		return ringbuffer_base::mlock(buf, sizeof(T) * Channels); }
+
+	//! try to unlock the data block using the syscall @a munlock
+	//! @return true iff the pages are guaranteed to be unlocked from RAM now
+	bool munlock() {
+		return ringbuffer_base::munlock(buf, sizeof(T) * Channels); }
+
+	//! overwrite the whole buffer with zeros
+	//! only allowed on startup (this is not fully checked!)
+	void touch()
+	{
+		assert(w_ptr.load() == 0);
+		assert(readers_left.load() == 0);
+		std::fill_n(reinterpret_cast<char*>(buf),
+			size * Channels * sizeof(T), '\0');
+	}
+};
+
+template<class T, std::size_t Channels>
+class soa_ringbuffer_reader_t : public ringbuffer_reader_base
+{
+	using rb_t = soa_ringbuffer_t<T, Channels>;
+	rb_t* ref;
+
+	//! like ringbuffer_reader_t::seq_base, but with one span per channel
+	template<class rb_ptr_type>
+	class seq_base
+	{
+		const T* const buf;
+		std::size_t range;
+	protected:
+		rb_ptr_type reader_ref;
+	public:
+		seq_base(rb_ptr_type rb, std::size_t arg_range) :
+			buf(rb->ref->buf),
+			range(arg_range),
+			reader_ref(rb)
+		{
+		}
+
+		seq_base(const seq_base& other) = delete;
+		seq_base(seq_base&& ) = default;
+
+		//! access of frame @a idx in channel @a c
+		const T& at(std::size_t c, std::size_t idx) const {
+			return *(channel_base(c) +
+				reader_ref->wrap(reader_ref->read_ptr + idx));
+		}
+
+		std::size_t size() const { return range; }
+
+		const T* channel_base(std::size_t c) const {
+			return buf + c * reader_ref->get_size(); }
+
+		//! span of channel @a c, of size first_half_size()
+		const T* first_half_ptr(std::size_t c) const {
+			return channel_base(c) + reader_ref->read_ptr; }
+		//! span of channel @a c, of size second_half_size()
+		const T* second_half_ptr(std::size_t c) const {
+			return channel_base(c); }
+		std::size_t first_half_size() const {
+			return reader_ref->read_space_1(range);
+		}
+		std::size_t second_half_size() const {
+			return reader_ref->read_space_2(range);
+		}
+
+		//! copy channel @a c into @a dest, which must hold size() objects
+		void copy_channel(std::size_t c, T* dest) const
+		{
+			const std::size_t h1 = first_half_size();
+			std::copy_n(first_half_ptr(c), h1, dest);
+			std::copy_n(second_half_ptr(c), second_half_size(),
+				dest + h1);
+		}
+
+		//! copy all frames interleaved into @a dest, which must hold
+		//! size() * Channels objects
+		void copy_interleaved(T* dest) const
+		{
+			const std::size_t h1 = first_half_size();
+			interleave(first_half_ptr(0), h1, dest);
+			interleave(second_half_ptr(0), second_half_size(),
+				dest + h1 * Channels);
+		}
+
+	private:
+		//! @a src points into channel 0
+		void interleave(const T* src, std::size_t amnt, T* dest) const
+		{
+			const std::size_t sz = reader_ref->get_size();
+			for(std::size_t i = 0; i < amnt; ++i, dest += Channels)
+			 for(std::size_t c = 0; c < Channels; ++c)
+			  dest[c] = src[c * sz + i];
+		}
+	};
+
+	std::size_t _read_max_spc(std::size_t range) const {
+		return std::min(read_space(), range);
+	}
+
+	std::size_t _read_spc(std::size_t range) const {
+		return detail::if_than_or_zero(read_space() >= range, range);
+	}
+
+	void try_inc(std::size_t range)
+	{
+		ringbuffer_reader_base::try_inc(*ref, range);
+	}
+
+public:
+	class peak_sequence_t : public seq_base<const soa_ringbuffer_reader_t*>
+	{
+	public:
+		using seq_base<const soa_ringbuffer_reader_t*>::seq_base;
+
+		peak_sequence_t(peak_sequence_t&& ) = default;
+	};
+
+	class read_sequence_t : public seq_base<soa_ringbuffer_reader_t*>
+	{
+	public:
+		using seq_base<soa_ringbuffer_reader_t*>::seq_base;
+
+		//! increases the read_ptr after reading
+		~read_sequence_t() {
+			seq_base<soa_ringbuffer_reader_t*>::reader_ref->
+				try_inc(seq_base<soa_ringbuffer_reader_t*>::size());
+		}
+
+		read_sequence_t(read_sequence_t&& ) = default;
+	};
+
+	//! constuctor. registers this reader at the ringbuffer
+	//! @note careful: this function is @a not thread-safe
+	soa_ringbuffer_reader_t(rb_t& arg_ref) :
+		ringbuffer_reader_base(arg_ref), ref(&arg_ref)
+	{
+		register_at(arg_ref);
+	}
+
+	//! reads min(@a range, @a read_space()) frames
+	read_sequence_t read_max(std::size_t range =
+		std::numeric_limits<std::size_t>::max()) {
+		return read_sequence_t(this, _read_max_spc(range));
+	}
+
+	//! reads @a range frames if @a range <= @a read_space(), otherwise 0
+	read_sequence_t read(std::size_t range) {
+		return read_sequence_t(this, _read_spc(range));
+	}
+
+	//! peaks min(@a range, @a read_space()) frames
+	peak_sequence_t peak_max(std::size_t range =
+		std::numeric_limits<std::size_t>::max()) const {
+		return peak_sequence_t(this, _read_max_spc(range));
+	}
+
+	//! peaks @a range frames if @a range <= @a read_space(), otherwise 0
+	peak_sequence_t peak(std::size_t range) const {
+		return peak_sequence_t(this, _read_spc(range));
+	}
+
+	//! returns number of frames that can be read at least
+	std::size_t read_space() const {
+		return ringbuffer_reader_base::read_space(load_w_ptr(*ref));
+	}
+
+	//! return the size that the reader expects from the ringbuffer
+	std::size_t get_size() const { return size; }
+};
+
+#endif // NO_CLASH_SOA_RINGBUFFER_H
@@ -0,0 +1,324 @@
+/*************************************************************************/
+/* ringbuffer - a multi-reader, lock-free ringbuffer lib                 */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef NO_CLASH_TRACED_RINGBUFFER_H
+#define NO_CLASH_TRACED_RINGBUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+#include "ringbuffer.h"
+
+//! histogram of latencies (in nanoseconds) that can be filled by one
+//! thread and read by others at the same time, without locks
+//! The buckets are log-linear (like in HdrHistogram): each power of two is
+//! split into 16 buckets, so the relative error is at most 1/16.
+class latency_histogram_t
+{
+	static constexpr unsigned sub_bits = 4;
+	static constexpr std::uint64_t sub_count = 1u << sub_bits;
+	static constexpr std::size_t bucket_count =
+		(64 - sub_bits + 1) * sub_count;
+
+	std::atomic<std::uint64_t> counts[bucket_count];
+	std::atomic<std::uint64_t> total, max_value;
+
+	//! index of the highest set bit, @a v must not be 0
+	static unsigned msb(std::uint64_t v)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return 63u - static_cast<unsigned>(__builtin_clzll(v));
+#else
+		unsigned res = 0;
+		while(v >>= 1)
+		 ++res;
+		return res;
+#endif
+	}
+
+public:
+	latency_histogram_t() { reset(); }
+	latency_histogram_t(const latency_histogram_t& ) = delete;
+
+	//! the bucket that @a v is counted in
+	static std::size_t index_of(std::uint64_t v)
+	{
+		if(v < sub_count)
+		 return static_cast<std::size_t>(v);
+		const unsigned e = msb(v) - sub_bits;
+		return static_cast<std::size_t>(e * sub_count + (v >> e));
+	}
+
+	//! the highest value that is counted in bucket @a idx
+	static std::uint64_t highest_of(std::size_t idx)
+	{
+		if(idx < sub_count)
+		 return idx;
+		const std::uint64_t e = idx / sub_count - 1,
+			m = idx % sub_count + sub_count;
+		return ((m + 1) << e) - 1;
+	}
+
+	//! counts a latency of @a ns nanoseconds
+	//! @note only one thread may call this at a time, so no atomic
+	//!   read-modify-write is required
+	void record(std::uint64_t ns)
+	{
+		std::atomic<std::uint64_t>& c = counts[index_of(ns)];
+		c.store(c.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+		total.store(total.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+		if(ns > max_value.load(std::memory_order_relaxed))
+		 max_value.store(ns, std::memory_order_relaxed);
+	}
+
+	//! only allowed while no thread is recording
+	void reset()
+	{
+		for(std::atomic<std::uint64_t>& c : counts)
+		 c.store(0, std::memory_order_relaxed);
+		total.store(0, std::memory_order_relaxed);
+		max_value.store(0, std::memory_order_relaxed);
+	}
+
+	std::uint64_t count() const {
+		return total.load(std::memory_order_relaxed); }
+	std::uint64_t max() const {
+		return max_value.load(std::memory_order_relaxed); }
+
+	//! returns a value that at least @a p percent of the latencies do not
+	//! exceed (up to the bucket precision), 0 if nothing was recorded
+	std::uint64_t percentile(double p) const
+	{
+		// the counts may change while we iterate, so we use their sum
+		std::uint64_t sum = 0;
+		for(const std::atomic<std::uint64_t>& c : counts)
+		 sum += c.load(std::memory_order_relaxed);
+		const double wanted = sum * p / 100.;
+		std::uint64_t seen = 0;
+		for(std::size_t i = 0; i < bucket_count; ++i)
+		{
+			seen += counts[i].load(std::memory_order_relaxed);
+			if(seen && seen >= wanted)
+			 return std::min(highest_of(i), max());
+		}
+		return max();
+	}
+
+	//! prints count and the usual percentiles (in nanoseconds) to @a os
+	void dump(std::ostream& os) const
+	{
+		os << "count " << count()
+			<< ", p50 " << percentile(50.)
+			<< ", p90 " << percentile(90.)
+			<< ", p99 " << percentile(99.)
+			<< ", p99.9 " << percentile(99.9)
+			<< ", max " << max() << " ns";
+	}
+};
+
+template<class T>
+class traced_reader_t;
+
+//! ringbuffer that stores a timestamp for each object
+//! The timestamp is taken after the objects have been copied, right before
+//! the write pointer publishes them. A write that wraps around is published
+//! in two parts, each with its own timestamp. The timestamps are stored in
+//! an array indexed like the data, so they are protected exactly like the
+//! data.
+//! @note write() and write_func() hide the versions of ringbuffer_t, so
+//!   writing through a ringbuffer_t reference does not stamp
+template<class T>
+class traced_ringbuffer_t : public ringbuffer_t<T>
+{
+public:
+	using clock = std::chrono::steady_clock;
+private:
+	template<class _T>
+	friend class traced_reader_t;
+
+	std::vector<std::int64_t> stamps; //!< nanoseconds since clock's epoch
+
+	//! wraps a copier and stamps the objects that it copies
+	//! ringbuffer_t::write_func publishes the objects directly after
+	//! calling this
+	template<class Func>
+	class stamping_copy
+	{
+		Func& f;
+		traced_ringbuffer_t& rb;
+	public:
+		void operator()(std::size_t src_off, std::size_t amnt, T* dest)
+		{
+			f(src_off, amnt, dest);
+			if(amnt) // write_func also calls this if nothing is writable
+			 std::fill_n(rb.stamps.begin() + (dest - rb.data()), amnt,
+				traced_ringbuffer_t::now());
+		}
+		stamping_copy(Func& arg_f, traced_ringbuffer_t& arg_rb) :
+			f(arg_f), rb(arg_rb) {}
+	};
+
+public:
+	static std::int64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			clock::now().time_since_epoch()).count();
+	}
+
+	//! allocating constructor, see ringbuffer_t
+	traced_ringbuffer_t(std::size_t sz, std::size_t retain_sz = 0) :
+		ringbuffer_t<T>(sz, retain_sz),
+		stamps(this->size)
+	{
+	}
+
+	//! allocating constructor, see ringbuffer_t and exact_capacity_t
+	traced_ringbuffer_t(std::size_t sz, exact_capacity_t,
+		std::size_t retain_sz = 0) :
+		ringbuffer_t<T>(sz, exact_capacity, retain_sz),
+		stamps(this->size)
+	{
+	}
+
+	//! like ringbuffer_t::write, but stamps the objects
+	std::size_t write(const T *src, std::size_t cnt) {
+		typename ringbuffer_t<T>::std_copy func(src);
+		return write_func(func, cnt);
+	}
+
+	//! like ringbuffer_t::write_func, but stamps the objects
+	template<class Func>
+	std::size_t write_func(Func& f, std::size_t cnt)
+	{
+		stamping_copy<Func> func(f, *this);
+		return ringbuffer_t<T>::template write_func<stamping_copy<Func>>(
+			func, cnt);
+	}
+};
+
+//! reader that records the latency between publishing and reading each
+//! object, see latency()
+//! @note only read(), read_max() and for_each_available() record latencies
+//! @note connect() and attach() hide the versions of ringbuffer_reader_t,
+//!   since the reader must also use the timestamps of the new ringbuffer
+template<class T>
+class traced_reader_t : public ringbuffer_reader_t<T>
+{
+	using base = ringbuffer_reader_t<T>;
+	using start_position = typename base::start_position;
+	const std::int64_t* stamps;
+	latency_histogram_t hist;
+
+	void record(std::size_t range)
+	{
+		const std::int64_t now = traced_ringbuffer_t<T>::now();
+		for(std::size_t i = 0; i < range; ++i)
+		{
+			const std::int64_t stamp =
+				stamps[this->wrap(this->read_ptr + i)];
+			hist.record(static_cast<std::uint64_t>(
+				now > stamp ? now - stamp : 0));
+		}
+	}
+
+public:
+	//! constuctor. registers this reader at the ringbuffer
+	//! @note careful: this function is @a not thread-safe
+	traced_reader_t(traced_ringbuffer_t<T>& arg_ref) :
+		base(arg_ref), stamps(arg_ref.stamps.data())
+	{
+	}
+
+	//! constuctor. no registration yet
+	//! thread safe
+	traced_reader_t(std::size_t sz) : base(sz), stamps(nullptr) {}
+
+	//! see ringbuffer_reader_t::connect
+	//! @note careful: this function is @a not thread-safe
+	void connect(traced_ringbuffer_t<T>& _ref,
+		start_position pos = start_position::current)
+	{
+		base::connect(_ref, pos);
+		stamps = _ref.stamps.data();
+	}
+
+	//! see ringbuffer_reader_t::attach
+	//! @note thread safe
+	void attach(traced_ringbuffer_t<T>& _ref,
+		start_position pos = start_position::current)
+	{
+		base::attach(_ref, pos);
+		stamps = _ref.stamps.data();
+	}
+
+	using read_sequence_t = typename base::read_sequence_t;
+
+	//! like ringbuffer_reader_t::read_max, but records the latencies
+	read_sequence_t read_max(std::size_t range =
+		std::numeric_limits<std::size_t>::max())
+	{
+		const std::size_t n = std::min(this->read_space(), range);
+		record(n);
+		return read_sequence_t(this, n);
+	}
+
+	//! like ringbuffer_reader_t::read, but records the latencies
+	read_sequence_t read(std::size_t range)
+	{
+		const std::size_t n = this->read_space() >= range ? range : 0;
+		record(n);
+		return read_sequence_t(this, n);
+	}
+
+	//! like ringbuffer_reader_t::for_each_available, but records the
+	//! latencies
+	template<class Func>
+	std::size_t for_each_available(Func f, std::size_t max_batch =
+		std::numeric_limits<std::size_t>::max())
+	{
+		assert(max_batch);
+		const std::size_t avail = this->read_space();
+		std::size_t res = 0;
+		while(res < avail)
+		{
+			auto seq = read_max(std::min(max_batch, avail - res));
+			detail::for_each_prefetched(seq.first_half_ptr(),
+				seq.first_half_size(), f);
+			detail::for_each_prefetched(seq.second_half_ptr(),
+				seq.second_half_size(), f);
+			res += seq.size();
+		}
+		return res;
+	}
+
+	//! the recorded latencies, can be read from any thread
+	const latency_histogram_t& latency() const { return hist; }
+	latency_histogram_t& latency() { return hist; }
+};
+
+#endif // NO_CLASH_TRACED_RINGBUFFER_H
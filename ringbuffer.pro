@@ -3,17 +3,35 @@ TARGET =
 DEPENDPATH += . \
 	src/lib \
 	src/test \
+	src/tools \
 	include
 INCLUDEPATH += . include
 
 # Input
-HEADERS += include/ringbuffer/ringbuffer.h
+HEADERS += include/ringbuffer/ringbuffer.h \
+	include/ringbuffer/ringbuffer_impl.h \
+	include/ringbuffer/sharded_ringbuffer.h \
+	include/ringbuffer/soa_ringbuffer.h \
+	include/ringbuffer/batched_writer.h \
+	include/ringbuffer/traced_ringbuffer.h
 SOURCES += src/lib/ringbuffer.cpp \
 	src/test/test_seq.cpp \
-	src/test/test_par.cpp
+	src/test/test_par.cpp \
+	src/test/test_sharded.cpp \
+	src/test/test_soa.cpp \
+	src/test/test_dynamic.cpp \
+	src/test/test_batch.cpp \
+	src/test/test_model.cpp \
+	src/test/test_stress.cpp \
+	src/test/test_traced.cpp \
+	src/test/test_exact.cpp \
+	src/tools/latency.cpp \
+	src/tools/capacity.cpp \
+	src/tools/batch.cpp
 
 OTHER_FILES += src/lib/CMakeLists.txt \
 	src/test/CMakeLists.txt \
+	src/tools/CMakeLists.txt \
 	src/CMakeLists.txt \
 	src/ringbuffer.pc.in \
 	CMakeLists.txt \
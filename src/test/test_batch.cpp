@@ -0,0 +1,106 @@
+/*************************************************************************/
+/* test_batch.cpp - test files for batched writing and reading           */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <ringbuffer/batched_writer.h>
+
+using m_type = long;
+using m_reader_t = ringbuffer_reader_t<m_type>;
+using m_buffer_t = ringbuffer_t<m_type>;
+
+int main()
+{
+	try {
+		m_buffer_t rb(16);
+		m_reader_t rd(rb);
+		batched_writer_t<m_type> wr(rb, 4);
+
+		// nothing is published before the batch is full
+		for(m_type i = 0; i < 3; ++i)
+		 assert(wr.push(i));
+		assert(!rd.read_space());
+		assert(wr.push(3));
+		assert(rd.read_space() == 4);
+		assert(!wr.staged_count());
+
+		assert(wr.push(4));
+		assert(wr.flush());
+		assert(rd.read_space() == 5);
+
+		std::vector<m_type> got;
+		assert(rd.for_each_available([&](const m_type& x) {
+			got.push_back(x); }, 2) == 5);
+		assert((got == std::vector<m_type>{0, 1, 2, 3, 4}));
+		assert(!rd.read_space());
+
+		// fill the ringbuffer until the reader blocks the writer
+		m_type next = 5;
+		while(wr.push(next))
+		 ++next;
+		assert(next == 19);
+		assert(wr.staged_count() == 4);
+		assert(rd.read_space() == 10);
+		got.clear();
+		assert(rd.for_each_available([&](const m_type& x) {
+			got.push_back(x); }) == 10);
+		assert(got.front() == 5 && got.back() == 14);
+
+		// the staged objects are kept, and wrap around the buffer end
+		assert(wr.flush());
+		got.clear();
+		rd.for_each_available([&](const m_type& x) { got.push_back(x); });
+		assert((got == std::vector<m_type>{15, 16, 17, 18}));
+
+		// destroying the writer writes the staged objects
+		{
+			batched_writer_t<m_type> wr2(rb, 4);
+			assert(wr2.push(19) && wr2.push(20));
+		}
+		assert(rd.read_space() == 2);
+		rd.read_max();
+
+		// pushing into a full batch succeeds if a flush frees some slots
+		{
+			m_buffer_t rb2(8);
+			m_reader_t rd2(rb2);
+			batched_writer_t<m_type> wr2(rb2, 6);
+			next = 0;
+			while(wr2.push(next))
+			 ++next;
+			assert(wr2.staged_count() == 6);
+			rd2.read_max();
+			assert(rb2.write_space() == 4); // less than staged
+			assert(wr2.push(next));
+			assert(wr2.staged_count() == 3);
+			rd2.read_max();
+			assert(wr2.flush());
+		}
+
+	} catch (const char* s)
+	{
+		std::cerr << s << std::endl;
+		return 1;
+	}
+
+	std::cerr << "SUCCESS!" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,211 @@
+/*************************************************************************/
+/* test_dynamic.cpp - test files for attaching, detaching and evicting   */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <atomic>
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <thread>
+#include <ringbuffer/ringbuffer.h>
+
+//! returns whether @a f throws the string @a msg
+template<class F>
+static bool throws(F f, const char* msg)
+{
+	try {
+		f();
+	} catch(const char* s) {
+		return !strcmp(s, msg);
+	}
+	return false;
+}
+
+static void test_seq()
+{
+	using m_reader_t = ringbuffer_reader_t<char>;
+	using m_buffer_t = ringbuffer_t<char>;
+
+	m_buffer_t rb(8);
+	rb.enable_eviction();
+	m_reader_t rd(rb);
+	assert(rb.write("abc", 3) == 3);
+
+	// a late reader starts on the writer's next half
+	m_reader_t late(8);
+	late.attach(rb);
+	assert(!late.read_space());
+	assert(rb.write("de", 2) == 2);
+	assert(late.read_space() == 1);
+	{
+		rd.read_max(5);
+	}
+	{
+		auto s = late.read_max(1);
+		assert(s[0] == 'e');
+	}
+	assert(rb.write_space() == 6);
+	assert(rb.write("fghijk", 6) == 6);
+	assert(!rb.write_space()); // both readers are in the previous half
+
+	// detaching does not block the writer anymore
+	late.detach();
+	assert(throws([&]{ late.read_space(); }, "reader is not connected"));
+	assert(!rb.write_space());
+
+	// evict the remaining reader
+	assert(!rd.evicted());
+	assert(rb.evict_lagging() == 1);
+	assert(rb.write_space() == 4);
+	assert(rd.evicted());
+	assert(throws([&]{ rd.read_space(); }, "reader has been evicted"));
+
+	// evicted readers can come back
+	rd.attach(rb);
+	assert(!rd.evicted());
+	assert(rb.write("lmno", 4) == 4);
+	{
+		auto s = rd.read_max();
+		assert(s.size() == 3);
+		assert(s[0] == 'm' && s[2] == 'o');
+	}
+
+	// automatic eviction
+	m_buffer_t rb2(8);
+	rb2.enable_eviction(2);
+	m_reader_t dead(rb2);
+	assert(rb2.write("abc", 3) == 3);
+	assert(rb2.write("de", 2) == 2);
+	assert(!dead.evicted());
+	// the writer can not know yet that dead lags more than 2 objects
+	assert(rb2.write("fgh", 3) == 2);
+	assert(!dead.evicted());
+	assert(rb2.write("h", 1) == 1);
+	assert(dead.evicted());
+
+	// readers within the threshold are not evicted
+	ringbuffer_t<int> rb3(64);
+	rb3.enable_eviction(24);
+	ringbuffer_reader_t<int> close(rb3);
+	int data[40] = {};
+	assert(rb3.write(data, 31) == 31);
+	assert(close.read_max().size() == 31);
+	assert(rb3.write(data, 1) == 1); // close lags 1 object
+	assert(rb3.write(data, 40) == 31);
+	assert(!close.evicted());
+	assert(close.read_max().size() == 32);
+	assert(rb3.write(data, 40) == 32);
+	assert(!close.evicted());
+	// now, close lags 32 objects
+	assert(rb3.write(data, 1) == 1);
+	assert(close.evicted());
+}
+
+using m_type = unsigned;
+using m_par_reader_t = ringbuffer_reader_t<m_type>;
+using m_par_buffer_t = ringbuffer_t<m_type>;
+
+constexpr std::size_t n_readers = 3;
+constexpr std::size_t n_sessions = 50;
+constexpr m_type threshold = 24;
+std::atomic<std::size_t> readers_done(0);
+std::atomic<m_type> written(0); //!< number of objects written
+
+static void write_messages(m_par_buffer_t* rb)
+{
+	for(m_type count = 0; readers_done != n_readers; )
+	{
+		if(rb->write(&count, 1))
+		 written.store(++count);
+	}
+}
+
+static void read_messages(m_par_buffer_t* rb)
+{
+	m_par_reader_t rd(64);
+	for(std::size_t session = 0; session < n_sessions; ++session)
+	{
+		rd.attach(*rb);
+		bool first = true;
+		m_type last = 0; //!< last value read before any eviction
+		try {
+			for(std::size_t got = 0; got < 100; )
+			{
+				// copy first: if we have been evicted, the writer might
+				// be overwriting seq meanwhile, so only the copies that
+				// were taken before the check are valid
+				m_type copy[16];
+				std::size_t n = 0;
+				{
+					auto seq = rd.read_max(16);
+					for(; n < seq.size(); ++n)
+					 copy[n] = seq[n];
+				}
+				if(rd.evicted())
+				 throw "reader has been evicted";
+				for(std::size_t i = 0; i < n; ++i, ++got)
+				{
+					assert(first || copy[i] == last + 1);
+					last = copy[i];
+					first = false;
+				}
+			}
+			rd.detach();
+		} catch(const char* s) {
+			// a slow reader might have been evicted, but only if it
+			// lagged more than the threshold (it was at last + 1 or later)
+			assert(!strcmp(s, "reader has been evicted"));
+			assert(first || written.load() > last + 1 + threshold);
+			rd.detach();
+		}
+	}
+	++readers_done;
+}
+
+static void test_par()
+{
+	m_par_buffer_t rb(64);
+	rb.enable_eviction(threshold);
+	// never reads, so it will be evicted
+	m_par_reader_t dead(rb);
+
+	std::thread writer(write_messages, &rb);
+	std::thread readers[n_readers];
+	for(std::thread& t : readers)
+	 t = std::thread(read_messages, &rb);
+	for(std::thread& t : readers)
+	 t.join();
+	writer.join();
+	assert(dead.evicted());
+}
+
+int main()
+{
+	try {
+		test_seq();
+		test_par();
+	} catch (const char* s)
+	{
+		std::cerr << s << std::endl;
+		return 1;
+	}
+
+	std::cerr << "SUCCESS!" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+/*************************************************************************/
+/* test_batch.cpp - test files for batched writing and reading           */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <iostream>
+#include <cassert>
+#include <ringbuffer/ringbuffer.h>
+#include <ringbuffer/soa_ringbuffer.h>
+
+using m_type = int;
+using m_reader_t = ringbuffer_reader_t<m_type>;
+using m_buffer_t = ringbuffer_t<m_type>;
+
+int main()
+{
+	try {
+		// sizes
+		assert(m_reader_t(6, exact_capacity).get_size() == 6);
+		assert(m_reader_t(7, exact_capacity).get_size() == 8);
+		assert(m_reader_t(1000, exact_capacity).get_size() == 1000);
+		assert(m_reader_t(1000).get_size() == 1024);
+		assert(m_buffer_t(1000, exact_capacity)
+			.maximum_eventual_write_space() == 500);
+
+		{
+			m_buffer_t rb(10, exact_capacity);
+			m_reader_t rd(rb);
+			assert(rd.get_size() == 10);
+			assert(rb.write_space() == 9);
+
+			// write and read across the buffer end many times
+			m_type next_w = 0, next_r = 0, buf[4];
+			for(int round = 0; round < 100; ++round)
+			{
+				const std::size_t n = static_cast<std::size_t>(round % 4) + 1;
+				for(std::size_t i = 0; i < n; ++i)
+				 buf[i] = next_w + static_cast<m_type>(i);
+				assert(rb.write(buf, n) == n);
+				next_w += static_cast<m_type>(n);
+				assert(rd.read_space() ==
+					static_cast<std::size_t>(next_w - next_r));
+
+				auto seq = rd.read_max(3);
+				assert(seq.first_half_size() + seq.second_half_size()
+					== seq.size());
+				for(std::size_t i = 0; i < seq.first_half_size(); ++i)
+				 assert(seq.first_half_ptr()[i] == next_r + static_cast<m_type>(i));
+				for(std::size_t i = 0; i < seq.size(); ++i)
+				 assert(seq[i] == next_r + static_cast<m_type>(i));
+				next_r += static_cast<m_type>(seq.size());
+			}
+
+			// the reader blocks the writer after one half
+			while(rd.read_space())
+			 rd.read_max();
+			std::size_t written = 0;
+			while(rb.write(buf, 1))
+			 ++written;
+			assert(written >= 5 && written < 10);
+		}
+
+		{
+			// retention across the buffer end
+			m_buffer_t rb(10, exact_capacity, 2);
+			m_reader_t rd(rb);
+			const m_type values[] = { 0, 1, 2 };
+			for(int i = 0; i < 5; ++i)
+			{
+				assert(rb.write(values, 3) == 3);
+				assert(rd.read(3).size() == 3);
+			}
+			assert(rd.rewindable() == 2);
+			assert(rd.rewind(3) == 2);
+			assert(rd.read_max()[0] == 1);
+		}
+
+		{
+			soa_ringbuffer_t<float, 2> rb(6, exact_capacity);
+			soa_ringbuffer_reader_t<float, 2> rd(rb);
+			const float frames[] = { 1, -1, 2, -2, 3, -3 };
+			for(int i = 0; i < 5; ++i)
+			{
+				assert(rb.write_interleaved(frames, 3) == 3);
+				auto s = rd.read_max();
+				assert(s.size() == 3);
+				for(std::size_t f = 0; f < 3; ++f)
+				 assert(s.at(0, f) == f + 1 && s.at(1, f) == -(f + 1.f));
+			}
+		}
+	} catch (const char* s)
+	{
+		std::cerr << s << std::endl;
+		return 1;
+	}
+
+	std::cerr << "SUCCESS!" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,509 @@
+/*************************************************************************/
+/* test_model.cpp - model checking the ringbuffer protocol               */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+// This test runs small programs on the ringbuffer for every possible
+// interleaving of the atomic operations (up to a number of preemptions).
+// It must be compiled with RINGBUFFER_MODEL_CHECK, which makes each atomic
+// operation call ringbuffer_schedule_point(). Only one thread runs at a
+// time, so this checks the protocol with sequential consistency, not the
+// memory orderings themselves.
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <ringbuffer/ringbuffer.h>
+
+#ifndef RINGBUFFER_MODEL_CHECK
+	#error "this test must be compiled with RINGBUFFER_MODEL_CHECK"
+#endif
+
+namespace {
+
+constexpr std::size_t no_thread = static_cast<std::size_t>(-1);
+thread_local std::size_t thread_id = no_thread;
+
+//! lets only one thread run at a time, and chooses the thread to run
+//! after each schedule point. Each execution follows the choices of the
+//! previous execution, except for the last one that has alternatives.
+class scheduler_t
+{
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::size_t current = 0;
+	std::vector<char> finished, waiting;
+	//! whether another thread has modified an atomic since the thread's
+	//! last call of wait()
+	std::vector<char> dirty;
+	//! atomic loads of each thread since any thread's last modification
+	std::vector<std::size_t> loads;
+	//! choices with alternatives: (option taken, number of options)
+	std::vector<std::pair<std::size_t, std::size_t>> trace;
+	std::vector<std::size_t> prefix; //!< choices to take in this execution
+	std::size_t preemptions = 0, steps = 0;
+	const std::size_t preemption_bound;
+	static constexpr std::size_t max_steps = 100000;
+	//! a thread with this many loads in a row spins, e.g. in leave_half()
+	static constexpr std::size_t spin_loads = 64;
+
+	[[noreturn]] void fail(const char* msg)
+	{
+		std::cerr << "FAILURE: " << msg << std::endl
+			<< "schedule:";
+		for(const auto& choice : trace)
+		 std::cerr << ' ' << choice.first;
+		std::cerr << std::endl;
+		std::_Exit(1);
+	}
+
+	//! chooses the next thread to run. The mutex must be locked.
+	//! The current thread is the first option, so switching is the
+	//! alternative (which might count as a preemption).
+	void schedule()
+	{
+		if(++steps > max_steps)
+		 fail("livelock");
+
+		std::vector<std::size_t> options;
+		const bool current_enabled =
+			!finished[current] && !waiting[current];
+		if(current_enabled)
+		 options.push_back(current);
+		if(!current_enabled || preemptions < preemption_bound)
+		{
+			for(std::size_t i = 0; i < finished.size(); ++i)
+			 if(i != current && !finished[i] && !waiting[i])
+			  options.push_back(i);
+		}
+
+		if(options.empty())
+		{
+			for(char f : finished)
+			 if(!f)
+			  fail("deadlock");
+			return;
+		}
+
+		std::size_t choice = 0;
+		if(options.size() > 1)
+		{
+			const std::size_t depth = trace.size();
+			choice = depth < prefix.size() ? prefix[depth] : 0;
+			trace.emplace_back(choice, options.size());
+		}
+		if(current_enabled && options[choice] != current)
+		 ++preemptions;
+		current = options[choice];
+		cv.notify_all();
+	}
+
+	void wait_for_turn(std::unique_lock<std::mutex>& lock)
+	{
+		cv.wait(lock, [&]{ return current == thread_id; });
+	}
+
+public:
+	scheduler_t(std::size_t bound) : preemption_bound(bound) {}
+
+	//! prepares the next execution with @a n_threads threads
+	void begin(std::size_t n_threads)
+	{
+		finished.assign(n_threads, 0);
+		waiting.assign(n_threads, 0);
+		dirty.assign(n_threads, 0);
+		loads.assign(n_threads, 0);
+		trace.clear();
+		preemptions = steps = 0;
+		// any thread can start, without a preemption
+		current = prefix.empty() ? 0 : prefix[0];
+		trace.emplace_back(current, n_threads);
+	}
+
+	//! chooses the prefix for the next execution
+	//! @return false if all executions have been explored
+	bool next()
+	{
+		while(!trace.empty())
+		{
+			if(trace.back().first + 1 < trace.back().second)
+			{
+				prefix.clear();
+				for(const auto& choice : trace)
+				 prefix.push_back(choice.first);
+				++prefix.back();
+				return true;
+			}
+			trace.pop_back();
+		}
+		return false;
+	}
+
+	void start()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		wait_for_turn(lock);
+	}
+
+	void finish()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		finished[thread_id] = 1;
+		schedule();
+	}
+
+	//! called after an atomic operation of the current thread
+	void yield(bool is_write)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if(is_write)
+		{
+			loads[thread_id] = 0;
+			wake_others();
+		}
+		else if(++loads[thread_id] == spin_loads)
+		{
+			// a spinning thread can only see something new after another
+			// thread's modification, so let it wait (otherwise, it would
+			// spin forever once the preemption bound is reached)
+			loads[thread_id] = 0;
+			waiting[thread_id] = 1;
+		}
+		schedule();
+		wait_for_turn(lock);
+	}
+
+	//! blocks the current thread until another thread modifies an atomic
+	//! (returns at once if that happened since the last call)
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if(dirty[thread_id])
+		{
+			dirty[thread_id] = 0;
+			return;
+		}
+		waiting[thread_id] = 1;
+		schedule();
+		wait_for_turn(lock);
+		// the caller will retry, and see all modifications
+		dirty[thread_id] = 0;
+	}
+
+	//! wakes all other threads that wait
+	void wake_others()
+	{
+		for(std::size_t i = 0; i < waiting.size(); ++i)
+		 if(i != thread_id)
+		  waiting[i] = 0, dirty[i] = 1, loads[i] = 0;
+	}
+
+	void check(bool condition, const char* msg)
+	{
+		if(!condition)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			fail(msg);
+		}
+	}
+
+	void notify()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		wake_others();
+	}
+};
+
+scheduler_t* scheduler = nullptr;
+
+using m_reader_t = ringbuffer_reader_t<int>;
+using m_buffer_t = ringbuffer_t<int>;
+using program_t = std::vector<std::function<void()>>;
+
+//! runs the program returned by @a setup in all interleavings
+template<class Setup>
+void explore(const char* name, std::size_t preemption_bound, Setup setup)
+{
+	scheduler_t sched(preemption_bound);
+	scheduler = &sched;
+	std::size_t executions = 0;
+	do
+	{
+		const program_t program = setup();
+		sched.begin(program.size());
+		std::vector<std::thread> threads;
+		for(std::size_t i = 0; i < program.size(); ++i)
+		{
+			threads.emplace_back([&, i]{
+				thread_id = i;
+				sched.start();
+				program[i]();
+				sched.finish();
+			});
+		}
+		for(std::thread& t : threads)
+		 t.join();
+		++executions;
+	} while(sched.next());
+	scheduler = nullptr;
+	std::cerr << name << ": " << executions << " executions" << std::endl;
+}
+
+void write_values(m_buffer_t& rb, int n)
+{
+	for(int i = 0; i < n; )
+	{
+		if(rb.write(&i, 1))
+		 ++i;
+		else
+		 scheduler->wait();
+	}
+}
+
+//! reads @a n values, expecting 0, 1, ...
+void read_values(m_reader_t& rd, int n)
+{
+	for(int expect = 0; expect < n; )
+	{
+		if(!rd.read_space())
+		 scheduler->wait();
+		else
+		{
+			auto seq = rd.read_max(2);
+			for(std::size_t i = 0; i < seq.size(); ++i, ++expect)
+			 scheduler->check(seq[i] == expect, "read wrong value");
+		}
+	}
+}
+
+struct one_reader_t
+{
+	m_buffer_t rb;
+	m_reader_t rd;
+	one_reader_t() : rb(4), rd(rb) {}
+};
+
+//! one writer, one reader, crossing both halves three times
+program_t one_reader()
+{
+	std::shared_ptr<one_reader_t> s(new one_reader_t);
+	return {
+		[s]{ write_values(s->rb, 6); },
+		[s]{ read_values(s->rd, 6); }
+	};
+}
+
+struct exact_size_t
+{
+	m_buffer_t rb;
+	m_reader_t rd;
+	exact_size_t() : rb(6, exact_capacity), rd(rb) {}
+};
+
+//! like one_reader, but with halves of 3 objects
+program_t exact_size()
+{
+	std::shared_ptr<exact_size_t> s(new exact_size_t);
+	return {
+		[s]{ write_values(s->rb, 8); },
+		[s]{ read_values(s->rd, 8); }
+	};
+}
+
+struct two_readers_t
+{
+	m_buffer_t rb;
+	m_reader_t rd1, rd2;
+	two_readers_t() : rb(4), rd1(rb), rd2(rb) {}
+};
+
+//! one writer, two readers, crossing both halves twice
+program_t two_readers()
+{
+	std::shared_ptr<two_readers_t> s(new two_readers_t);
+	return {
+		[s]{ write_values(s->rb, 4); },
+		[s]{ read_values(s->rd1, 4); },
+		[s]{ read_values(s->rd2, 4); }
+	};
+}
+
+struct attach_detach_t
+{
+	m_buffer_t rb;
+	m_reader_t rd1, late;
+	bool done = false; // protected by the scheduler
+	attach_detach_t() : rb(4), rd1(rb), late(4) {}
+};
+
+//! a reader attaches and detaches while the writer is running
+program_t attach_detach()
+{
+	std::shared_ptr<attach_detach_t> s(new attach_detach_t);
+	return {
+		[s]{
+			write_values(s->rb, 6);
+			s->done = true;
+			scheduler->notify();
+		},
+		[s]{ read_values(s->rd1, 6); },
+		[s]{
+			m_reader_t& rd = s->late;
+			rd.attach(s->rb);
+			bool first = true;
+			int last = 0;
+			for(int got = 0; got < 2; )
+			{
+				if(rd.read_space())
+				{
+					// the read space may only grow until we read
+					auto seq = rd.read_max(1);
+					scheduler->check(seq.size() == 1,
+						"late reader's read space has shrunk");
+					const int value = seq[0];
+					scheduler->check(first || value == last + 1,
+						"late reader read wrong value");
+					first = false;
+					last = value;
+					++got;
+				}
+				else if(s->done)
+				 break;
+				else
+				 scheduler->wait();
+			}
+			rd.detach();
+		}
+	};
+}
+
+struct eviction_t
+{
+	static constexpr int threshold = 1;
+	m_buffer_t rb;
+	m_reader_t rd;
+	//! whether the reader detaches at once when it stops reading
+	const bool detach_early;
+	int written = 0; // protected by the scheduler
+	bool done = false; // protected by the scheduler
+	eviction_t(bool arg_detach_early) :
+		rb(4), rd(4), detach_early(arg_detach_early)
+	{
+		rb.enable_eviction(threshold);
+		rd.connect(rb);
+	}
+};
+
+//! number of executions where the reader was evicted while reading
+std::size_t evicted_while_reading = 0;
+
+//! a reader reads some values and then stops, so the writer must evict
+//! it (maybe while the reader leaves its half), unless it detaches first
+//! (which can happen while the writer evicts it)
+program_t eviction(bool detach_early)
+{
+	std::shared_ptr<eviction_t> s(new eviction_t(detach_early));
+	return {
+		[s]{
+			for(int i = 0; i < 6; )
+			{
+				if(s->rb.write(&i, 1))
+				 s->written = ++i;
+				else
+				 scheduler->wait();
+			}
+			s->done = true;
+			scheduler->notify();
+		},
+		[s]{
+			m_reader_t& rd = s->rd;
+			int next = 0; // all values before have been read
+			try {
+				while(next < 3)
+				{
+					if(!rd.read_space())
+					{
+						scheduler->wait();
+						continue;
+					}
+					auto seq = rd.read_max(std::min(2, 3 - next));
+					int values[2];
+					for(std::size_t i = 0; i < seq.size(); ++i)
+					 values[i] = seq[i];
+					// the copies are only valid if we were not evicted
+					if(rd.evicted())
+					 throw "reader has been evicted";
+					for(std::size_t i = 0; i < seq.size(); ++i, ++next)
+					 scheduler->check(values[i] == next,
+						"read wrong value");
+				}
+				// stop reading, the writer can only finish by evicting us
+				while(!s->detach_early && !s->done)
+				 scheduler->wait();
+				scheduler->check(s->detach_early || rd.evicted(),
+					"stopped reader has not been evicted");
+			} catch(const char* msg) {
+				scheduler->check(!strcmp(msg, "reader has been evicted"),
+					"unexpected exception");
+				// the writer may only evict us if we lag more than
+				// the threshold
+				scheduler->check(s->written > next + eviction_t::threshold,
+					"reader evicted within the threshold");
+				++evicted_while_reading;
+			}
+			rd.detach();
+		}
+	};
+}
+
+}
+
+void ringbuffer_schedule_point(bool is_write)
+{
+	if(scheduler && thread_id != no_thread)
+	 scheduler->yield(is_write);
+}
+
+int main()
+{
+	try {
+		explore("one reader", 2, one_reader);
+		explore("exact size", 2, exact_size);
+		explore("two readers", 1, two_readers);
+		explore("attach and detach", 1, attach_detach);
+		explore("eviction", 2, []{ return eviction(false); });
+		explore("eviction and detach", 2, []{ return eviction(true); });
+		if(!evicted_while_reading)
+		 throw "the reader was never evicted while reading";
+	} catch (const char* s)
+	{
+		std::cerr << s << std::endl;
+		return 1;
+	}
+
+	std::cerr << "SUCCESS!" << std::endl;
+
+	return 0;
+}
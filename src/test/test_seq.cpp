@@ -112,14 +112,57 @@ int main()
 		{
 			auto s = rd.read_max(3);
 			assert(s.size()==3);
-			//assert(s.first_half_size() == 2);
-			//assert(s.second_half_size() == 1);
+			assert(s.first_half_size() == 2);
+			assert(s.second_half_size() == 1);
 			assert_equal(s.first_half_ptr()[0], 'a');
 			assert(s.first_half_ptr()[1] == 'b');
 			assert(s.second_half_ptr()[0] == 'c');
 
 		}
 
+		// keep 2 objects behind the readers out of the writer's reach
+		{
+			m_buffer_t rb(8, 2);
+			m_reader_t rd(rb);
+			assert(rb.maximum_eventual_write_space() == 2);
+			assert(!rd.rewindable());
+
+			assert(rb.write("abcde", 5) == 5);
+			assert(!rb.write_space());
+			{
+				rd.read_max(3);
+			}
+			assert(rd.rewindable() == 2);
+			assert(rd.rewind(5) == 2);
+			assert(rd.read_space() == 4);
+			{
+				auto s = rd.read_max(4);
+				assert(s[0] == 'b' && s[3] == 'e');
+			}
+			assert(rd.rewindable() == 2);
+
+			// "d" and "e" must not be overwritten now
+			assert(rb.write_space() == 4);
+			assert(rb.write("fghi", 4) == 4);
+			assert(!rb.write_space());
+
+			// late reader, starting with the retained objects
+			m_reader_t rd2(rb,
+				m_reader_t::start_position::oldest_retained);
+			{
+				auto s = rd2.read_max();
+				assert(s.size() == 2);
+				assert(s[0] == 'h' && s[1] == 'i');
+			}
+
+			assert(rd.seek_to_oldest() == 2);
+			{
+				auto s = rd.read_max();
+				assert(s.size() == 6);
+				assert(s[0] == 'd' && s[5] == 'i');
+			}
+		}
+
 	} catch (const char* s)
 	{
 		std::cerr << s << std::endl;
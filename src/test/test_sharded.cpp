@@ -0,0 +1,227 @@
+/*************************************************************************/
+/* test_sharded.cpp - test files for sharded ringbuffers                 */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <cassert>
+#include <thread>
+#include <ringbuffer/sharded_ringbuffer.h>
+
+struct message_t
+{
+	std::size_t producer, seq;
+};
+
+using m_buffer_t = sharded_ringbuffer_t<message_t>;
+using m_reader_t = sharded_reader_t<message_t>;
+
+constexpr std::size_t n_producers = 4;
+constexpr std::size_t n_messages = 2000;
+
+static void write_messages(m_buffer_t* rb, std::size_t producer)
+{
+	for(std::size_t seq = 0; seq < n_messages; ++seq)
+	{
+		message_t m { producer, seq };
+		// spin locks are no good idea here
+		// this is just for demonstration
+		while(!rb->write(&m, 1))
+		;
+	}
+}
+
+static void test_parallel()
+{
+	m_buffer_t rb(64, n_producers);
+	m_reader_t rd(rb);
+
+	std::vector<std::thread> producers;
+	for(std::size_t p = 0; p < n_producers; ++p)
+	 producers.emplace_back(write_messages, &rb, p);
+
+	std::size_t expected[n_producers] = {};
+	std::size_t total = 0;
+	// a second reader, registered while the producers are writing
+	std::unique_ptr<m_reader_t> late;
+	std::size_t late_expected[n_producers] = {};
+	bool late_started[n_producers] = {};
+	auto late_check = [&](const message_t& m) {
+		// the late reader may start anywhere, but has no gaps
+		assert(!late_started[m.producer] ||
+			m.seq == late_expected[m.producer]);
+		late_started[m.producer] = true;
+		late_expected[m.producer] = m.seq + 1;
+	};
+	while(total < n_producers * n_messages)
+	{
+		total += rd.read_batched([&](const message_t& m) {
+			// order of each producer must be kept
+			assert(m.seq == expected[m.producer]);
+			++expected[m.producer];
+		}, 8);
+		if(late)
+		 late->read_batched(late_check, 8);
+		else if(total >= n_messages)
+		 late.reset(new m_reader_t(rb));
+	}
+
+	for(std::thread& t : producers)
+	 t.join();
+	assert(rb.get_num_shards() == n_producers);
+	assert(!rd.read_space());
+	late->read_batched(late_check, 8);
+	for(std::size_t p = 0; p < n_producers; ++p)
+	 assert(!late_started[p] || late_expected[p] == n_messages);
+}
+
+static void test_thread_churn()
+{
+	// more producer threads than shards, but only one at a time
+	m_buffer_t rb(16, 2);
+	m_reader_t rd(rb);
+	for(std::size_t p = 0; p < 5; ++p)
+	{
+		std::thread t([&]{
+			for(std::size_t seq = 0; seq < 3; ++seq)
+			{
+				message_t m { p, seq };
+				assert(rb.write(&m, 1) == 1);
+			}
+		});
+		t.join();
+		// the new thread took over the shard of the exited one
+		assert(rb.get_num_shards() == 1);
+		std::size_t expected = 0;
+		rd.read_batched([&](const message_t& m) {
+			assert(m.producer == p && m.seq == expected);
+			++expected;
+		}, 8);
+		assert(expected == 3);
+	}
+
+	// a thread that is still running keeps its shard
+	message_t m { 0, 0 };
+	assert(rb.write(&m, 1) == 1);
+	std::thread t([&]{ assert(rb.write(&m, 1) == 1); });
+	t.join();
+	assert(rb.get_num_shards() == 2);
+	assert(rd.read_space() == 2);
+}
+
+static void test_ordered()
+{
+	// the "producer" field is used as a timestamp here
+	m_buffer_t rb(16, 2);
+	m_reader_t rd(rb);
+
+	const message_t in1[] = { {1, 0}, {4, 0}, {5, 0} };
+	const message_t in2[] = { {2, 1}, {3, 1}, {6, 1} };
+	rb.write(in1, 3); // main thread creates shard 0
+	std::thread t([&]{ rb.write(in2, 3); }); // creates shard 1
+	t.join();
+	assert(rb.get_num_shards() == 2);
+
+	std::size_t last = 0;
+	auto check = [&](const message_t& m) {
+		assert(m.producer == last + 1);
+		last = m.producer;
+	};
+	auto key = [](const message_t& m) { return m.producer; };
+	std::size_t n = rd.read_ordered(check, key, 4);
+	assert(n == 4);
+	assert(rd.read_space() == 2); // only the passed objects are read
+	n = rd.read_ordered(check, key);
+	assert(n == 2);
+	assert(last == 6);
+	(void)n;
+	assert(rb.maximum_eventual_write_space() == 8);
+
+	// round robin alternates between the shards
+	rb.write(in1, 2);
+	t = std::thread([&]{ rb.write(in2, 2); });
+	t.join();
+	std::vector<std::size_t> order;
+	rd.read_round_robin([&](const message_t& m) {
+		order.push_back(m.seq); });
+	assert((order == std::vector<std::size_t>{0, 1, 0, 1}));
+}
+
+static void test_destroyed_reader()
+{
+	m_buffer_t rb(16, 1);
+	const message_t m[16] = {};
+	{
+		m_reader_t rd(rb);
+		assert(rb.write(m, 4) == 4);
+	}
+	// the destroyed reader does not block the producer anymore
+	for(int i = 0; i < 10; ++i)
+	 assert(rb.write(m, 8) == 8);
+}
+
+static void test_many_facades()
+{
+	// more facades than a thread's shard cache can hold
+	constexpr std::size_t n_facades = 11;
+	std::vector<std::unique_ptr<m_buffer_t>> rbs;
+	std::vector<std::unique_ptr<m_reader_t>> rds;
+	for(std::size_t i = 0; i < n_facades; ++i)
+	{
+		rbs.emplace_back(new m_buffer_t(16, 1));
+		rds.emplace_back(new m_reader_t(*rbs[i]));
+	}
+
+	for(std::size_t seq = 0; seq < 3; ++seq)
+	 for(std::size_t i = 0; i < n_facades; ++i)
+	{
+		message_t m { i, seq };
+		assert(rbs[i]->write(&m, 1) == 1);
+	}
+
+	for(std::size_t i = 0; i < n_facades; ++i)
+	{
+		assert(rbs[i]->get_num_shards() == 1);
+		std::size_t expected = 0;
+		rds[i]->read_batched([&](const message_t& m) {
+			assert(m.producer == i && m.seq == expected);
+			++expected;
+		}, 8);
+		assert(expected == 3);
+	}
+}
+
+int main()
+{
+	try {
+		test_destroyed_reader();
+		test_many_facades();
+		test_ordered();
+		test_thread_churn();
+		test_parallel();
+	} catch (const char* s)
+	{
+		std::cerr << s << std::endl;
+		return 1;
+	}
+
+	std::cerr << "SUCCESS!" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*************************************************************************/
+/* test_soa.cpp - test files for struct of arrays ringbuffers            */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <iostream>
+#include <cassert>
+#include <ringbuffer/soa_ringbuffer.h>
+
+using m_buffer_t = soa_ringbuffer_t<float, 2>;
+using m_reader_t = soa_ringbuffer_reader_t<float, 2>;
+
+int main()
+{
+	try {
+		m_buffer_t rb(8);
+		m_reader_t rd(rb);
+		assert(!rd.read_space());
+
+		// interleaved stereo frames: (left, right) = (i, -i)
+		const float frames[] = { 1, -1, 2, -2, 3, -3, 4, -4, 5, -5,
+			6, -6, 7, -7 };
+		std::size_t n = rb.write_interleaved(frames, 7);
+		assert(n == 7);
+		(void)n;
+		{
+			auto s = rd.read_max(5);
+			assert(s.size() == 5);
+			assert(s.first_half_size() == 5
+				&& !s.second_half_size());
+			for(std::size_t i = 0; i < 5; ++i)
+			{
+				assert(s.first_half_ptr(0)[i] == i + 1);
+				assert(s.first_half_ptr(1)[i] == -(i + 1.f));
+			}
+		}
+
+		// write planar, wrapping around the buffer end
+		const float left[] = { 8, 9, 10 };
+		const float right[] = { -8, -9, -10 };
+		const float* planar[] = { left, right };
+		assert(rb.write_planar(planar, 3) == 3);
+		assert(rd.read_space() == 5);
+		{
+			auto s = rd.read_max(5);
+			assert(s.first_half_size() == 3);
+			assert(s.second_half_size() == 2);
+			assert(s.at(0, 3) == 9 && s.at(1, 4) == -10);
+			assert(s.second_half_ptr(0)[0] == 9);
+
+			float inter[10];
+			s.copy_interleaved(inter);
+			for(std::size_t i = 0; i < 5; ++i)
+			{
+				assert(inter[2 * i] == i + 6);
+				assert(inter[2 * i + 1] == -(i + 6.f));
+			}
+
+			float right_out[5];
+			s.copy_channel(1, right_out);
+			assert(right_out[0] == -6 && right_out[4] == -10);
+		}
+		assert(!rd.read_space());
+
+	} catch (const char* s)
+	{
+		std::cerr << s << std::endl;
+		return 1;
+	}
+
+	std::cerr << "SUCCESS!" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,184 @@
+/*************************************************************************/
+/* test_par.cpp - test files for parallel ringbuffer writing             */
+/* Copyright (C) 2014-2019                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+// This test runs one writer and multiple readers with random delays and
+// random batch sizes, in order to hit as many interleavings as possible.
+// Some readers keep attaching and detaching while the writer runs.
+// It is built once with the default and once with the minimal memory
+// orderings (see RINGBUFFER_MINIMAL_ORDERING), and with the latter also
+// with ThreadSanitizer (see RINGBUFFER_TSAN_TESTS).
+// Usage: test_stress [number of values [exact capacity]]
+// Without an exact capacity, the ringbuffer has the default size of 64.
+
+#include <atomic>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <ringbuffer/ringbuffer.h>
+
+using m_type = unsigned;
+using m_reader_t = ringbuffer_reader_t<m_type>;
+using m_buffer_t = ringbuffer_t<m_type>;
+
+std::size_t buffer_size = 64;
+bool exact = false; //!< whether buffer_size is an exact capacity
+m_type n_values = 1000000;
+std::atomic<bool> writer_done(false);
+
+//! busy waits or yields for a random time, or not at all
+static void random_delay(std::minstd_rand& rng)
+{
+	switch(rng() % 8)
+	{
+		case 0:
+			std::this_thread::yield();
+			break;
+		case 1:
+			for(volatile unsigned i = 0, max = rng() % 256; i < max; ++i)
+			;
+			break;
+		default:
+			break;
+	}
+}
+
+static void write_values(m_buffer_t* rb, unsigned seed)
+{
+	std::minstd_rand rng(seed);
+	m_type buf[32];
+	for(m_type next = 0; next < n_values; )
+	{
+		const std::size_t batch = std::min<std::size_t>(
+			rng() % 32 + 1, n_values - next);
+		for(std::size_t i = 0; i < batch; ++i)
+		 buf[i] = next + static_cast<m_type>(i);
+		const std::size_t written = rb->write(buf, batch);
+		next += static_cast<m_type>(written);
+		if(!written)
+		 std::this_thread::yield();
+		random_delay(rng);
+	}
+	writer_done = true;
+}
+
+static void read_values(m_reader_t* rd, unsigned seed)
+{
+	std::minstd_rand rng(seed);
+	for(m_type expect = 0; expect < n_values; )
+	{
+		if(!rd->read_space())
+		 std::this_thread::yield();
+		else
+		{
+			auto seq = rd->read_max(rng() % 32 + 1);
+			for(std::size_t i = 0; i < seq.size(); ++i, ++expect)
+			 if(seq[i] != expect)
+			  throw "read wrong value";
+		}
+		random_delay(rng);
+	}
+}
+
+//! attaches, reads some values and detaches again (sometimes before
+//! reading anything), until the writer is done
+static void rejoin_values(m_buffer_t* rb, unsigned seed)
+{
+	std::minstd_rand rng(seed);
+	std::unique_ptr<m_reader_t> rd_ptr(exact
+		? new m_reader_t(buffer_size, exact_capacity)
+		: new m_reader_t(buffer_size));
+	m_reader_t& rd = *rd_ptr;
+	bool any = false;
+	m_type last = 0; //!< last value read in any session
+	while(!writer_done)
+	{
+		rd.attach(*rb);
+		bool first = true;
+		for(std::size_t got = 0, want = rng() % 64;
+			got < want && !writer_done; )
+		{
+			if(!rd.read_space())
+			 std::this_thread::yield();
+			else
+			{
+				auto seq = rd.read_max(rng() % 32 + 1);
+				for(std::size_t i = 0; i < seq.size(); ++i, ++got)
+				{
+					// a session starts at any newer value
+					if(first ? (any && seq[i] <= last) : seq[i] != last + 1)
+					 throw "rejoining reader read wrong value";
+					first = false;
+					any = true;
+					last = seq[i];
+				}
+			}
+			random_delay(rng);
+		}
+		rd.detach();
+		random_delay(rng);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if(argc > 1)
+	 n_values = static_cast<m_type>(std::strtoul(argv[1], nullptr, 10));
+	if(argc > 2)
+	{
+		buffer_size = std::strtoul(argv[2], nullptr, 10);
+		exact = true;
+	}
+
+	std::unique_ptr<m_buffer_t> rb_ptr(exact
+		? new m_buffer_t(buffer_size, exact_capacity)
+		: new m_buffer_t(buffer_size));
+	m_buffer_t& rb = *rb_ptr;
+	constexpr std::size_t n_readers = 3, n_rejoining = 2;
+	m_reader_t rd[n_readers] = { rb, rb, rb };
+
+	//! calls @a f and exits on failure
+	auto checked = [](std::function<void()> f) {
+		try {
+			f();
+		} catch(const char* s) {
+			std::cerr << s << std::endl;
+			std::exit(1);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.emplace_back([&]{ write_values(&rb, 1); });
+	for(std::size_t i = 0; i < n_readers; ++i)
+	 threads.emplace_back([&, i]{ checked([&]{
+		read_values(rd + i, static_cast<unsigned>(i + 2)); }); });
+	for(std::size_t i = 0; i < n_rejoining; ++i)
+	 threads.emplace_back([&, i]{ checked([&]{
+		rejoin_values(&rb, static_cast<unsigned>(i + n_readers + 2)); }); });
+	for(std::thread& t : threads)
+	 t.join();
+
+	std::cerr << "SUCCESS!" << std::endl;
+
+	return 0;
+}
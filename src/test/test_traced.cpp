@@ -0,0 +1,128 @@
+/*************************************************************************/
+/* test_batch.cpp - test files for batched writing and reading           */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <cassert>
+#include <cstdint>
+#include <thread>
+#include <ringbuffer/traced_ringbuffer.h>
+
+using m_type = int;
+using m_reader_t = traced_reader_t<m_type>;
+using m_buffer_t = traced_ringbuffer_t<m_type>;
+
+int main()
+{
+	try {
+		// buckets are ordered and precise up to 1/16
+		std::size_t last = 0;
+		for(std::uint64_t v = 0; v < (1u << 20); v += 1 + v / 64)
+		{
+			const std::size_t idx = latency_histogram_t::index_of(v);
+			const std::uint64_t hi = latency_histogram_t::highest_of(idx);
+			assert(idx >= last);
+			assert(hi >= v && hi - v <= v / 16);
+			last = idx;
+		}
+		assert(latency_histogram_t::highest_of(latency_histogram_t::
+			index_of(UINT64_MAX)) == UINT64_MAX);
+
+		{
+			latency_histogram_t hist;
+			assert(hist.percentile(50.) == 0);
+			for(std::uint64_t v = 1; v <= 1000; ++v)
+			 hist.record(v);
+			assert(hist.count() == 1000);
+			assert(hist.max() == 1000);
+			assert(hist.percentile(50.) >= 500 && hist.percentile(50.) < 532);
+			assert(hist.percentile(99.9) >= 999);
+			assert(hist.percentile(100.) == 1000);
+		}
+
+		m_buffer_t rb(16);
+		m_reader_t rd(rb);
+		const m_type values[] = { 0, 1, 2, 3, 4, 5 };
+		assert(rb.write(values, 4) == 4);
+		{
+			auto seq = rd.read_max(3);
+			assert(seq.size() == 3 && seq[2] == 2);
+		}
+		assert(rd.latency().count() == 3);
+		assert(!rd.read(2).size()); // not enough objects
+		assert(rd.latency().count() == 3);
+
+		// wrap around, so the timestamps are split like the data
+		for(int i = 0; i < 4; ++i)
+		{
+			assert(rb.write(values, 6) == 6);
+			assert(rd.read(6).size() == 6);
+		}
+		assert(rd.read_max().size() == 1);
+		assert(rd.latency().count() == 28);
+		assert(rd.latency().percentile(50.) <= rd.latency().max());
+		// the objects were read after they were written
+		assert(rd.latency().max() < 60ull * 1000 * 1000 * 1000);
+
+		// the timestamps are taken after copying, so slow copiers do not
+		// count as latency
+		{
+			m_buffer_t rb2(16);
+			m_reader_t rd2(rb2);
+			auto slow_copy = [](std::size_t, std::size_t amnt, m_type* dest) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+				std::fill_n(dest, amnt, 0);
+			};
+			assert(rb2.write_func(slow_copy, 3) == 3);
+			assert(rd2.read_max().size() == 3);
+			assert(rd2.latency().max() < 50ull * 1000 * 1000);
+		}
+
+		// a reader attached to another ringbuffer uses its timestamps
+		// (rb's stamps are older than the 50 ms of the slow copier)
+		{
+			rd.detach();
+			rd.latency().reset();
+			m_buffer_t rb3(16);
+			rd.attach(rb3);
+			assert(rb3.write(values, 6) == 6);
+			assert(rb3.write(values, 5) == 5); // enter the next half
+			m_type sum = 0;
+			assert(rd.for_each_available([&](m_type v) { sum += v; }, 2) == 3);
+			assert(sum == 2 + 3 + 4);
+			assert(rd.latency().count() == 3);
+			assert(rd.latency().max() < 50ull * 1000 * 1000);
+
+			m_reader_t rd3(16);
+			rd3.attach(rb3);
+			assert(rb3.write(values, 6) == 6); // enter the next half
+			assert(rd3.for_each_available([](m_type) {}) == 1);
+			assert(rd3.latency().count() == 1);
+		}
+	} catch (const char* s)
+	{
+		std::cerr << s << std::endl;
+		return 1;
+	}
+
+	std::cerr << "SUCCESS!" << std::endl;
+
+	return 0;
+}
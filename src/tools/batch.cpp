@@ -0,0 +1,92 @@
+/*************************************************************************/
+/* batch.cpp - benchmark for single and batched writes                   */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+// Compares writing single objects with ringbuffer_t::write() to staging
+// them in a batched_writer_t. The reader drains the ringbuffer after each
+// batch in both cases, so only the writer differs.
+// Build with CMAKE_BUILD_TYPE=Release for useful numbers.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <ringbuffer/batched_writer.h>
+
+using m_type = int;
+using m_reader_t = ringbuffer_reader_t<m_type>;
+using m_buffer_t = ringbuffer_t<m_type>;
+
+//! writes and reads @a rounds batches of @a batch objects, writing
+//! each object with write() if @a batched is false, otherwise with
+//! a batched_writer_t
+//! @return nanoseconds per object
+static double run(std::size_t batch, std::size_t rounds, bool batched)
+{
+	m_buffer_t rb(4096);
+	m_reader_t rd(rb);
+	batched_writer_t<m_type> wr(rb, batch);
+	const m_type one = 1;
+	long long sum = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+	for(std::size_t r = 0; r < rounds; ++r)
+	{
+		if(batched)
+		{
+			for(std::size_t i = 0; i < batch; ++i)
+			 wr.push(one);
+		}
+		else
+		{
+			for(std::size_t i = 0; i < batch; ++i)
+			 rb.write(&one, 1);
+		}
+		rd.for_each_available([&](const m_type& v) { sum += v; });
+	}
+	const auto end = std::chrono::steady_clock::now();
+
+	if(sum != static_cast<long long>(rounds * batch))
+	 throw "wrong number of objects read";
+	return std::chrono::duration<double, std::nano>(end - start).count()
+		/ (rounds * batch);
+}
+
+int main(int argc, char** argv)
+{
+	try {
+		const std::size_t count = argc > 1
+			? std::strtoul(argv[1], nullptr, 10) : 50000000;
+		const std::size_t batches[] = { 16, 64, 256 };
+		if(count < 256)
+		 throw "usage: ringbuffer-batch-bench [count]";
+
+		for(std::size_t batch : batches)
+		{
+			std::cout << "batch " << batch << ": "
+				<< run(batch, count / batch, false) << " (write), "
+				<< run(batch, count / batch, true) << " (batched_writer_t)"
+				<< " ns per object" << std::endl;
+		}
+	} catch (const char* s)
+	{
+		std::cerr << s << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
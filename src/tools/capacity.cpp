@@ -0,0 +1,113 @@
+/*************************************************************************/
+/* capacity.cpp - benchmark for masked and exact capacity indexing       */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+// Compares the power-of-two sizes (masked indexing) with exact capacities
+// (indexing with a conditional subtraction), see exact_capacity_t.
+// Both operator[] (one wrap per object) and for_each_available (no wrap)
+// are measured. Build with CMAKE_BUILD_TYPE=Release for useful numbers.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <ringbuffer/ringbuffer.h>
+
+using m_type = int;
+using m_reader_t = ringbuffer_reader_t<m_type>;
+using m_buffer_t = ringbuffer_t<m_type>;
+
+//! writes and reads @a rounds batches of @a batch objects, accessing
+//! each object with operator[] if @a indexed is true, otherwise
+//! using for_each_available (i.e. the pointers to both halves)
+//! @return nanoseconds per object
+static double run(m_buffer_t& rb, std::size_t batch, std::size_t rounds,
+	bool indexed)
+{
+	m_reader_t rd(rb);
+	std::vector<m_type> src(batch, 1);
+	long long sum = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+	for(std::size_t r = 0; r < rounds; ++r)
+	{
+		rb.write(src.data(), batch);
+		if(indexed)
+		{
+			auto seq = rd.read_max(batch);
+			for(std::size_t i = 0; i < seq.size(); ++i)
+			 sum += seq[i];
+		}
+		else
+		 rd.for_each_available([&](const m_type& v) { sum += v; });
+	}
+	const auto end = std::chrono::steady_clock::now();
+
+	if(sum != static_cast<long long>(rounds * batch))
+	 throw "wrong number of objects read";
+	return std::chrono::duration<double, std::nano>(end - start).count()
+		/ (rounds * batch);
+}
+
+int main(int argc, char** argv)
+{
+	try {
+		const std::size_t count = argc > 1
+			? std::strtoul(argv[1], nullptr, 10) : 50000000;
+		const std::size_t batch = 61; // does not divide any size below
+		if(count < batch)
+		 throw "usage: ringbuffer-capacity-bench [count]";
+
+		struct config_t { const char* name; std::size_t size; bool exact; };
+		const config_t configs[] = {
+			{ "masked, 4096", 4096, false },
+			{ "exact, 4094", 4094, true },
+			{ "exact, 3000", 3000, true },
+			{ "masked, 1 << 20", 1 << 20, false },
+			{ "exact, 1 << 20 - 2", (1 << 20) - 2, true }
+		};
+		for(const config_t& c : configs)
+		{
+			std::cout << c.name << ":";
+			for(bool indexed : { true, false })
+			{
+				std::unique_ptr<m_buffer_t> rb(c.exact
+					? new m_buffer_t(c.size, exact_capacity)
+					: new m_buffer_t(c.size));
+				rb->touch();
+				std::cout << ' ' << run(*rb, batch, count / batch, indexed)
+					<< (indexed ? " (operator[])," : " (for_each_available)");
+			}
+			std::cout << " ns per object" << std::endl;
+		}
+
+		// memory needed for 1.1M writable objects
+		const std::size_t writable = 1100000;
+		std::cout << "allocated for " << writable << " writable objects: "
+			<< m_reader_t(2 * writable).get_size() << " (masked), "
+			<< m_reader_t(2 * writable, exact_capacity).get_size()
+			<< " (exact)" << std::endl;
+	} catch (const char* s)
+	{
+		std::cerr << s << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+/*************************************************************************/
+/* latency.cpp - tool for measuring the latency between write and read   */
+/* Copyright (C) 2014-2020                                               */
+/* Johannes Lorenz (j.git@lorenz-ho.me, $$$=@)                           */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+// Measures the latency between writing and reading objects, for each
+// reader. Pin the threads (e.g. with taskset) to compare core placements.
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <ringbuffer/traced_ringbuffer.h>
+
+using m_type = long;
+using m_reader_t = traced_reader_t<m_type>;
+using m_buffer_t = traced_ringbuffer_t<m_type>;
+
+static void usage()
+{
+	std::cerr << "usage: ringbuffer-latency "
+		"[size [readers [batch [count]]]]" << std::endl
+		<< "defaults: size 1024, readers 2, batch 16, count 1000000"
+		<< std::endl;
+}
+
+static std::size_t parse(int argc, char** argv, int idx, std::size_t dflt)
+{
+	if(argc <= idx)
+	 return dflt;
+	char* end;
+	const unsigned long res = std::strtoul(argv[idx], &end, 10);
+	if(*end || !res)
+	 throw "arguments must be positive numbers";
+	return res;
+}
+
+static void write_objects(m_buffer_t* rb, std::size_t batch,
+	std::size_t count)
+{
+	std::vector<m_type> buf(batch);
+	for(std::size_t written = 0; written < count; )
+	{
+		const std::size_t n = std::min(batch, count - written);
+		for(std::size_t i = 0; i < n; ++i)
+		 buf[i] = static_cast<m_type>(written + i);
+		const std::size_t res = rb->write(buf.data(), n);
+		if(!res)
+		 std::this_thread::yield();
+		written += res;
+	}
+}
+
+static void read_objects(m_reader_t* rd, std::size_t count)
+{
+	for(std::size_t got = 0; got < count; )
+	{
+		const std::size_t res = rd->read_max().size();
+		if(!res)
+		 std::this_thread::yield();
+		got += res;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	try {
+		if(argc > 5)
+		{
+			usage();
+			return 1;
+		}
+		const std::size_t size = parse(argc, argv, 1, 1024),
+			n_readers = parse(argc, argv, 2, 2),
+			batch = parse(argc, argv, 3, 16),
+			count = parse(argc, argv, 4, 1000000);
+
+		m_buffer_t rb(size);
+		if(batch > rb.maximum_eventual_write_space())
+		 throw "batch must fit into half the buffer";
+		rb.mlock();
+		std::vector<std::unique_ptr<m_reader_t>> readers;
+		for(std::size_t i = 0; i < n_readers; ++i)
+		 readers.emplace_back(new m_reader_t(rb));
+
+		std::vector<std::thread> threads;
+		for(std::size_t i = 0; i < n_readers; ++i)
+		 threads.emplace_back(read_objects, readers[i].get(), count);
+		threads.emplace_back(write_objects, &rb, batch, count);
+		for(std::thread& t : threads)
+		 t.join();
+
+		for(std::size_t i = 0; i < n_readers; ++i)
+		{
+			std::cout << "reader " << i << ": ";
+			readers[i]->latency().dump(std::cout);
+			std::cout << std::endl;
+		}
+	} catch (const char* s)
+	{
+		std::cerr << s << std::endl;
+		usage();
+		return 1;
+	}
+
+	return 0;
+}